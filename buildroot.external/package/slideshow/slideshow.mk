@@ -6,6 +6,22 @@
 
 SLIDESHOW_SITE_METHOD = local
 SLIDESHOW_SITE = $(TOPDIR)/../slideshow
+SLIDESHOW_DEPENDENCIES = freetype jpeg libdrm
+SLIDESHOW_CONF_OPTS = -Dconvert=false
+
+ifeq ($(BR2_PACKAGE_LIBPNG),y)
+SLIDESHOW_DEPENDENCIES += libpng
+SLIDESHOW_CONF_OPTS += -Dpng=enabled
+else
+SLIDESHOW_CONF_OPTS += -Dpng=disabled
+endif
+
+ifeq ($(BR2_PACKAGE_WEBP),y)
+SLIDESHOW_DEPENDENCIES += webp
+SLIDESHOW_CONF_OPTS += -Dwebp=enabled
+else
+SLIDESHOW_CONF_OPTS += -Dwebp=disabled
+endif
 
 define SLIDESHOW_INSTALL_INIT_SYSV
 	$(INSTALL) -Dm0755 $(BR2_EXTERNAL)/package/slideshow/S20slideshow $(TARGET_DIR)/etc/init.d/S20slideshow
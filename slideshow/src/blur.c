@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: MIT
+// Blur filter.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#include "blur.h"
+
+#include "pool.h"
+#include "scale.h"
+
+#include <math.h>
+#include <string.h>
+
+/** Number of box filter passes. */
+#define BLUR_PASSES 3
+
+/** Fixed point precision of the box filter reciprocal. */
+#define RECIP_BITS 16
+
+/** Max radius of the box filter: averaged value must fit into 8 bits. */
+#define MAX_RADIUS 127
+
+/**
+ * Horizontal pass of the box filter.
+ * @param dst,src destination and source rows
+ * @param width row width in pixels
+ * @param bpp number of bytes per pixel
+ * @param radius filter radius
+ */
+static void box_row(uint8_t* dst, const uint8_t* src, size_t width, size_t bpp,
+                    size_t radius)
+{
+    const uint32_t recip = ((1 << RECIP_BITS) + radius * 2) / (radius * 2 + 1);
+    const size_t last = width - 1;
+
+    for (size_t c = 0; c < bpp; ++c) {
+        uint32_t sum = src[c] * (radius + 1);
+        for (size_t i = 1; i <= radius; ++i) {
+            sum += src[(i < last ? i : last) * bpp + c];
+        }
+        for (size_t x = 0; x < width; ++x) {
+            const size_t add = x + radius + 1;
+            const size_t sub = x > radius ? x - radius : 0;
+            dst[x * bpp + c] = (sum * recip) >> RECIP_BITS;
+            sum += src[(add < last ? add : last) * bpp + c];
+            sum -= src[sub * bpp + c];
+        }
+    }
+}
+
+/**
+ * Vertical pass of the box filter, running sums are kept for all columns.
+ * @param dst,src destination and source images
+ * @param size row size in bytes (width * bpp)
+ * @param height image height
+ * @param stride size of the image row in bytes
+ * @param radius filter radius
+ * @param sums buffer for running sums, size * sizeof(uint32_t)
+ */
+static void box_col(uint8_t* dst, const uint8_t* src, size_t size,
+                    size_t height, size_t stride, size_t radius,
+                    uint32_t* sums)
+{
+    const uint32_t recip = ((1 << RECIP_BITS) + radius * 2) / (radius * 2 + 1);
+    const size_t last = height - 1;
+
+    for (size_t x = 0; x < size; ++x) {
+        sums[x] = src[x] * (radius + 1);
+    }
+    for (size_t i = 1; i <= radius; ++i) {
+        const uint8_t* row = src + (i < last ? i : last) * stride;
+        for (size_t x = 0; x < size; ++x) {
+            sums[x] += row[x];
+        }
+    }
+
+    for (size_t y = 0; y < height; ++y) {
+        const size_t add = y + radius + 1;
+        const size_t sub = y > radius ? y - radius : 0;
+        const uint8_t* add_row = src + (add < last ? add : last) * stride;
+        const uint8_t* sub_row = src + sub * stride;
+        uint8_t* dst_row = dst + y * stride;
+        for (size_t x = 0; x < size; ++x) {
+            dst_row[x] = (sums[x] * recip) >> RECIP_BITS;
+            sums[x] += add_row[x];
+            sums[x] -= sub_row[x];
+        }
+    }
+}
+
+bool blur(uint8_t* data, size_t width, size_t height, size_t stride,
+          size_t bpp, float sigma)
+{
+    const size_t size = width * bpp;
+    size_t radius;
+    uint8_t* tmp;
+    uint32_t* sums;
+
+    if (sigma <= 0.0f || width == 0 || height == 0) {
+        return true;
+    }
+
+    // box size for the given sigma: n * (w^2 - 1) / 12 = sigma^2,
+    // rounded as small sigmas on tiny images are still expected to blur
+    radius =
+        (sqrtf(12.0f * sigma * sigma / BLUR_PASSES + 1.0f) - 1.0f) / 2 + 0.5f;
+    if (radius == 0) {
+        radius = 1;
+    }
+    if (radius > MAX_RADIUS) {
+        radius = MAX_RADIUS;
+    }
+
+    tmp = pool_alloc(height * stride + size * sizeof(*sums));
+    if (!tmp) {
+        return false;
+    }
+    sums = (uint32_t*)(tmp + height * stride);
+
+    for (size_t i = 0; i < BLUR_PASSES; ++i) {
+        for (size_t y = 0; y < height; ++y) {
+            box_row(tmp + y * stride, data + y * stride, width, bpp, radius);
+        }
+        box_col(data, tmp, size, height, stride, radius, sums);
+    }
+
+    pool_free(tmp);
+    return true;
+}
+
+/**
+ * Fill part of the frame buffer line with horizontally stretched image row.
+ * @param dst destination line
+ * @param row source image row
+ * @param xmap fixed point positions of the destination pixels in the row
+ * @param begin,end range of the destination pixels to fill
+ * @param last index of the last pixel in the source row
+ */
+static void fill_span(xrgb_t* dst, const xrgb_t* row, const uint32_t* xmap,
+                      size_t begin, size_t end, size_t last)
+{
+    for (size_t x = begin; x < end; ++x) {
+        const size_t x0 = xmap[x] >> SCALE_FRAC_BITS;
+        const size_t x1 = x0 < last ? x0 + 1 : last;
+        dst[x] = scale_blend(row[x0], row[x1], xmap[x] & SCALE_FRAC_MASK);
+    }
+}
+
+bool blur_fill(struct buffer* fb, const struct rect* rect,
+               const struct buffer* img)
+{
+    const float scale_w = (float)fb->width / img->width;
+    const float scale_h = (float)fb->height / img->height;
+    const float scale = scale_w > scale_h ? scale_w : scale_h;
+    const float offset_x = (img->width - fb->width / scale) / 2;
+    const float offset_y = (img->height - fb->height / scale) / 2;
+    const size_t last_x = img->width - 1;
+    const size_t last_y = img->height - 1;
+    const size_t right = rect->x + rect->width;
+    const size_t bottom = rect->y + rect->height;
+    uint32_t* xmap;
+    xrgb_t* row;
+
+    // fixed point positions of the frame buffer columns in the image and
+    // the image row interpolated vertically
+    xmap = pool_alloc(fb->width * sizeof(*xmap) + img->width * sizeof(*row));
+    if (!xmap) {
+        return false;
+    }
+    row = (xrgb_t*)(xmap + fb->width);
+    for (size_t x = 0; x < fb->width; ++x) {
+        const float pos = offset_x + (x + 0.5f) / scale - 0.5f;
+        xmap[x] = pos > 0 ? pos * SCALE_FRAC_ONE : 0;
+    }
+
+    for (size_t y = 0; y < fb->height; ++y) {
+        const float pos = offset_y + (y + 0.5f) / scale - 0.5f;
+        const uint32_t fy = pos > 0 ? pos * SCALE_FRAC_ONE : 0;
+        const size_t y0 = fy >> SCALE_FRAC_BITS;
+        const size_t y1 = y0 < last_y ? y0 + 1 : last_y;
+        const xrgb_t* row0 = (const xrgb_t*)(img->data + y0 * img->stride);
+        const xrgb_t* row1 = (const xrgb_t*)(img->data + y1 * img->stride);
+        xrgb_t* dst = (xrgb_t*)(fb->data + y * fb->stride);
+        const bool inside = y >= rect->y && y < bottom;
+
+        if (inside && rect->x == 0 && right >= fb->width) {
+            continue; // no bars on this line
+        }
+
+        // the image is small, so blend its rows first and then interpolate
+        // only horizontally for each frame buffer pixel
+        for (size_t x = 0; x < img->width; ++x) {
+            row[x] = scale_blend(row0[x], row1[x], fy & SCALE_FRAC_MASK);
+        }
+
+        if (inside) {
+            fill_span(dst, row, xmap, 0, rect->x, last_x);
+            fill_span(dst, row, xmap, right, fb->width, last_x);
+        } else {
+            fill_span(dst, row, xmap, 0, fb->width, last_x);
+        }
+    }
+
+    pool_free(xmap);
+
+    fb->drawn = (struct rect) { 0, 0, fb->width, fb->height };
+
+    return true;
+}
@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: MIT
+// Blur filter.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#pragma once
+
+#include "display.h"
+
+#include <stdbool.h>
+
+/**
+ * Blur image: three passes of the box filter approximate Gaussian blur.
+ * @param data pointer to the image data
+ * @param width,height image size in pixels
+ * @param stride size of the image row in bytes
+ * @param bpp number of bytes per pixel, each byte is blurred independently
+ * @param sigma standard deviation of the approximated Gaussian
+ * @return false if not enough memory
+ */
+bool blur(uint8_t* data, size_t width, size_t height, size_t stride,
+          size_t bpp, float sigma);
+
+/**
+ * Fill frame buffer outside the rectangle with the image stretched to cover
+ * the whole frame buffer.
+ * @param fb destination frame buffer
+ * @param rect rectangle to leave untouched
+ * @param img source image
+ * @return false if not enough memory, the frame buffer is not changed
+ */
+bool blur_fill(struct buffer* fb, const struct rect* rect,
+               const struct buffer* img);
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: MIT
+// Image format decoders.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#pragma once
+
+#include "image.h"
+
+#include <stdio.h>
+
+/** Size of the file signature used to detect the image format. */
+#define CODEC_SIGNATURE 12
+/** Max total decoding time of the image (milliseconds). */
+#define CODEC_MAX_TIME 10000
+/** Max size of the buffer for the whole decoded image (bytes). */
+#define CODEC_MAX_BUFFER (64 * 1024 * 1024)
+
+/**
+ * Image format decoder.
+ * The image is opened in two steps: the header is read first to get the
+ * source size, then decoding is started with the output size hint. After that
+ * the image is decoded row by row. Decoders that can't output rows before the
+ * whole image is decoded keep it in a buffer limited by CODEC_MAX_BUFFER.
+ * The close function is called for any opened image, including the ones that
+ * failed to open. Decoders set image->corrupt if they fail because of invalid
+ * image data, but not because of I/O errors, lack of memory or limits.
+ * The date of taking the photo (image->date) is set by the open function if
+ * the format has it.
+ */
+struct codec {
+    size_t context; ///< Size of the decoder context (image->decoder)
+    /** Check the file signature, see CODEC_SIGNATURE. */
+    bool (*match)(const uint8_t* sig, size_t size);
+    /** Read the header and set the source size of the image. */
+    bool (*open)(struct image* img, FILE* file);
+    /** Start decoding and set the output size of the image. */
+    bool (*start)(struct image* img, size_t width, size_t height);
+    /** Decode next row of the image. */
+    bool (*read)(struct image* img, xrgb_t* row);
+    /** Free decoder resources and close the file. */
+    void (*close)(struct image* img);
+};
+
+/**
+ * Get current monotonic time.
+ * @return time in milliseconds
+ */
+uint64_t codec_time(void);
+
+/** JPEG decoder. */
+extern const struct codec codec_jpeg;
+
+#ifdef HAVE_PNG
+/** PNG decoder. */
+extern const struct codec codec_png;
+#endif
+
+#ifdef HAVE_WEBP
+/** WebP decoder. */
+extern const struct codec codec_webp;
+#endif
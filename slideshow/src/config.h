@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: MIT
+// Slide show configuration.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#pragma once
+
+#include "display.h"
+#include "render.h"
+
+#include <stdbool.h>
+
+/** Default directory for cache files. */
+#define CACHE_DIR "/var/cache"
+
+/** Slide show configuration. */
+struct config {
+    bool independent;         ///< Independent slide sequence on each output
+    struct display_mode mode; ///< Preferred display mode
+    bool mode_auto;           ///< Detect display mode from the image list
+    const char* control;      ///< Path to the control socket
+    enum background bkg;      ///< Letterbox fill mode
+    const char* font;         ///< Caption font file, NULL to disable caption
+    size_t font_size;         ///< Caption font size, 0 for auto
+    bool kenburns;            ///< Animate slides with pan and zoom
+};
@@ -0,0 +1,506 @@
+// SPDX-License-Identifier: MIT
+// Batch converter: prepare photos for the slide show.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#include "font.h"
+#include "image.h"
+#include "pool.h"
+#include "render.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** Max number of files waiting in the work queue. */
+#define QUEUE_SIZE 64
+
+/** Max number of worker threads. */
+#define MAX_JOBS 64
+
+/** Caption margin from the bottom right corner (pixels). */
+#define CAPTION_MARGIN 10
+
+/** Caption shadow blur. */
+#define CAPTION_SHADOW 4.0f
+
+/** Converter configuration. */
+struct options {
+    size_t width;               ///< Output image width
+    size_t height;              ///< Output image height
+    size_t jobs;                ///< Number of worker threads
+    const char* font;           ///< Path to the caption font file
+    size_t font_size;           ///< Caption font size
+    xrgb_t font_color;          ///< Caption color
+    int quality;                ///< Output JPEG quality
+    const char* src_dir;        ///< Source directory
+    const char* dst_dir;        ///< Destination directory
+    char caption[NAME_MAX + 1]; ///< Caption text (source directory name)
+};
+
+/** Bounded work queue. */
+struct queue {
+    char* files[QUEUE_SIZE]; ///< File names
+    size_t head;             ///< Index of the first file in the queue
+    size_t size;             ///< Number of files in the queue
+    bool closed;             ///< No more files will be added
+    size_t converted;        ///< Number of converted files
+    size_t failed;           ///< Number of failed files
+    pthread_mutex_t lock;    ///< Queue lock
+    pthread_cond_t put;      ///< Signaled when a file is added
+    pthread_cond_t get;      ///< Signaled when a file is taken
+};
+
+/** Command line arguments. */
+struct cmdarg {
+    const char short_opt; ///< Short option character
+    const char* long_opt; ///< Long option name
+    const char* format;   ///< Format description
+    const char* help;     ///< Help string
+};
+
+// clang-format off
+static const struct cmdarg arguments[] = {
+    { 's', "size",       "WxH",    "output image size (4096x2160)" },
+    { 'j', "jobs",       "NUM",    "number of threads (all cores)" },
+    { 'f', "font",       "PATH",   "caption font file, no caption if not set" },
+    { 'z', "font-size",  "NUM",    "caption font size (80)" },
+    { 'c', "font-color", "RRGGBB", "caption color (cccccc)" },
+    { 'q', "quality",    "NUM",    "output JPEG quality (80)" },
+    { 'v', "version",    NULL,     "print version info and exit" },
+    { 'h', "help",       NULL,     "print this help and exit" },
+};
+// clang-format on
+
+/** Converter configuration. */
+static struct options opts = {
+    .width = 4096,
+    .height = 2160,
+    .font_size = 80,
+    .font_color = 0xffcccccc,
+    .quality = 80,
+};
+
+/** Work queue. */
+static struct queue queue = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .put = PTHREAD_COND_INITIALIZER,
+    .get = PTHREAD_COND_INITIALIZER,
+};
+
+/**
+ * Print usage info.
+ */
+static void print_help(void)
+{
+    puts("Usage: slideshow-convert [OPTION]... SRCDIR DSTDIR");
+    for (size_t i = 0; i < sizeof(arguments) / sizeof(arguments[0]); ++i) {
+        const struct cmdarg* arg = &arguments[i];
+        char lopt[32];
+        if (arg->format) {
+            snprintf(lopt, sizeof(lopt), "%s=%s", arg->long_opt, arg->format);
+        } else {
+            strncpy(lopt, arg->long_opt, sizeof(lopt) - 1);
+        }
+        printf("  -%c, --%-17s %s\n", arg->short_opt, lopt, arg->help);
+    }
+}
+
+/**
+ * Parse command line arguments.
+ * @param argc number of arguments to parse
+ * @param argv arguments array
+ * @return index of the first non option argument
+ */
+static int parse_cmdargs(int argc, char* argv[])
+{
+    struct option options[1 + sizeof(arguments) / sizeof(arguments[0])];
+    char short_opts[sizeof(arguments) / sizeof(arguments[0]) * 2];
+    char* short_opts_ptr = short_opts;
+    char* end;
+    int opt;
+
+    // compose array of option structs
+    for (size_t i = 0; i < sizeof(arguments) / sizeof(arguments[0]); ++i) {
+        const struct cmdarg* arg = &arguments[i];
+        options[i].name = arg->long_opt;
+        options[i].has_arg = arg->format ? required_argument : no_argument;
+        options[i].flag = NULL;
+        options[i].val = arg->short_opt;
+        // compose short options string
+        *short_opts_ptr++ = arg->short_opt;
+        if (arg->format) {
+            *short_opts_ptr++ = ':';
+        }
+    }
+    // add terminations
+    *short_opts_ptr = 0;
+    memset(&options[sizeof(arguments) / sizeof(arguments[0])], 0,
+           sizeof(struct option));
+
+    // parse arguments
+    while ((opt = getopt_long(argc, argv, short_opts, options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                opts.width = strtoul(optarg, &end, 10);
+                if (*end == 'x') {
+                    opts.height = strtoul(end + 1, &end, 10);
+                }
+                if (!opts.width || !opts.height || *end) {
+                    fprintf(stderr, "Invalid size: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'j':
+                opts.jobs = strtoul(optarg, &end, 10);
+                if (!opts.jobs || opts.jobs > MAX_JOBS || *end) {
+                    fprintf(stderr, "Invalid number of jobs: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'f':
+                opts.font = optarg;
+                break;
+            case 'z':
+                opts.font_size = strtoul(optarg, &end, 10);
+                if (!opts.font_size || *end) {
+                    fprintf(stderr, "Invalid font size: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'c':
+                opts.font_color =
+                    strtoul(optarg[0] == '#' ? optarg + 1 : optarg, &end, 16);
+                if (*end) {
+                    fprintf(stderr, "Invalid color: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                opts.font_color |= (xrgb_t)0xff << 24;
+                break;
+            case 'q':
+                opts.quality = strtol(optarg, &end, 10);
+                if (opts.quality <= 0 || opts.quality > 100 || *end) {
+                    fprintf(stderr, "Invalid quality: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'v':
+                puts("slideshow-convert version " APP_VERSION ".");
+                exit(EXIT_SUCCESS);
+                break;
+            case 'h':
+                print_help();
+                exit(EXIT_SUCCESS);
+                break;
+            default:
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    return optind;
+}
+
+/**
+ * Check if the file name has JPEG extension.
+ * @param name file name
+ * @return true if file is JPEG
+ */
+static bool is_jpeg(const char* name)
+{
+    const char* ext = strrchr(name, '.');
+    return ext && (strcmp(ext, ".jpg") == 0 || strcmp(ext, ".JPG") == 0 ||
+                   strcmp(ext, ".jpeg") == 0 || strcmp(ext, ".JPEG") == 0);
+}
+
+/**
+ * Check if the output file is up to date.
+ * @param src,dst paths to the source and output files
+ * @return true if output file exists and is not older than the source
+ */
+static bool is_actual(const char* src, const char* dst)
+{
+    struct stat src_st, dst_st;
+
+    return stat(src, &src_st) == 0 && stat(dst, &dst_st) == 0 &&
+        dst_st.st_mtime >= src_st.st_mtime;
+}
+
+/**
+ * Put file to the queue, waits while the queue is full.
+ * @param name file name
+ */
+static void queue_put(char* name)
+{
+    pthread_mutex_lock(&queue.lock);
+    while (queue.size == QUEUE_SIZE) {
+        pthread_cond_wait(&queue.get, &queue.lock);
+    }
+    queue.files[(queue.head + queue.size) % QUEUE_SIZE] = name;
+    ++queue.size;
+    pthread_cond_signal(&queue.put);
+    pthread_mutex_unlock(&queue.lock);
+}
+
+/**
+ * Get file from the queue, waits while the queue is empty.
+ * @return file name or NULL if the queue is closed and empty
+ */
+static char* queue_get(void)
+{
+    char* name = NULL;
+
+    pthread_mutex_lock(&queue.lock);
+    while (queue.size == 0 && !queue.closed) {
+        pthread_cond_wait(&queue.put, &queue.lock);
+    }
+    if (queue.size) {
+        name = queue.files[queue.head];
+        queue.head = (queue.head + 1) % QUEUE_SIZE;
+        --queue.size;
+        pthread_cond_signal(&queue.get);
+    }
+    pthread_mutex_unlock(&queue.lock);
+
+    return name;
+}
+
+/**
+ * Close the queue: wake up all workers waiting for a file.
+ */
+static void queue_close(void)
+{
+    pthread_mutex_lock(&queue.lock);
+    queue.closed = true;
+    pthread_cond_broadcast(&queue.put);
+    pthread_mutex_unlock(&queue.lock);
+}
+
+/**
+ * Convert single file.
+ * @param name file name
+ * @param fb frame buffer to draw on
+ * @param caption rendered caption, can be NULL
+ * @return true if file was converted successfully
+ */
+static bool convert_file(const char* name, struct buffer* fb,
+                         const struct text* caption)
+{
+    char src[PATH_MAX], dst[PATH_MAX], tmp[PATH_MAX];
+
+    snprintf(src, sizeof(src), "%s/%s", opts.src_dir, name);
+    snprintf(dst, sizeof(dst), "%s/%s", opts.dst_dir, name);
+    snprintf(tmp, sizeof(tmp), "%s/.%s.tmp", opts.dst_dir, name);
+
+    if (!render_image(src, &fb, 1, BKG_BLUR)) {
+        fprintf(stderr, "Unable to load image %s\n", src);
+        return false;
+    }
+
+    if (caption && caption->width + CAPTION_MARGIN <= fb->width &&
+        caption->height + CAPTION_MARGIN <= fb->height) {
+        font_draw(caption, fb, fb->width - caption->width - CAPTION_MARGIN,
+                  fb->height - caption->height - CAPTION_MARGIN,
+                  opts.font_color);
+    }
+
+    // write to temporary file to not leave the broken one on interrupt
+    if (!image_save(tmp, (const xrgb_t*)fb->data, fb->width, fb->height,
+                    fb->stride, opts.quality) ||
+        rename(tmp, dst) != 0) {
+        fprintf(stderr, "Unable to save image %s: [%d] %s\n", dst, errno,
+                strerror(errno));
+        unlink(tmp);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Worker thread: convert files from the queue.
+ * @param arg rendered caption, can be NULL
+ * @return NULL
+ */
+static void* worker(void* arg)
+{
+    const struct text* caption = arg;
+    struct buffer fb = { 0 };
+    char* name;
+
+    fb.width = opts.width;
+    fb.height = opts.height;
+    fb.stride = fb.width * sizeof(xrgb_t);
+    fb.size = fb.stride * fb.height;
+    fb.drawn = (struct rect) { 0, 0, fb.width, fb.height };
+    fb.data = pool_alloc(fb.size);
+    if (!fb.data) {
+        fprintf(stderr, "Not enough memory\n");
+    }
+
+    while ((name = queue_get())) {
+        const bool rc = fb.data && convert_file(name, &fb, caption);
+        pthread_mutex_lock(&queue.lock);
+        if (rc) {
+            printf("Converted %zu: %s\n", ++queue.converted, name);
+        } else {
+            ++queue.failed;
+        }
+        pthread_mutex_unlock(&queue.lock);
+        free(name);
+    }
+
+    pool_free(fb.data);
+
+    return NULL;
+}
+
+/**
+ * Scan source directory and put outdated files to the queue.
+ * @return number of skipped up to date files
+ */
+static size_t scan_dir(void)
+{
+    DIR* dir_handle;
+    struct dirent* dir_entry;
+    size_t skipped = 0;
+
+    dir_handle = opendir(opts.src_dir);
+    if (!dir_handle) {
+        fprintf(stderr, "Unable to open directory %s: [%d] %s\n",
+                opts.src_dir, errno, strerror(errno));
+        return 0;
+    }
+
+    while ((dir_entry = readdir(dir_handle))) {
+        char src[PATH_MAX], dst[PATH_MAX];
+        const char* name = dir_entry->d_name;
+        char* copy;
+
+        if (name[0] == '.' || !is_jpeg(name)) {
+            continue;
+        }
+
+        snprintf(src, sizeof(src), "%s/%s", opts.src_dir, name);
+        snprintf(dst, sizeof(dst), "%s/%s", opts.dst_dir, name);
+        if (is_actual(src, dst)) {
+            ++skipped;
+            continue;
+        }
+
+        copy = strdup(name);
+        if (copy) {
+            queue_put(copy);
+        }
+    }
+
+    closedir(dir_handle);
+
+    return skipped;
+}
+
+/**
+ * Set caption to the name of the source directory.
+ * @param path path to the source directory
+ */
+static void set_caption(const char* path)
+{
+    char cwd[PATH_MAX];
+    size_t len = strlen(path);
+    const char* name;
+
+    // strip trailing slashes
+    while (len > 1 && path[len - 1] == '/') {
+        --len;
+    }
+    name = path + len;
+    while (name > path && name[-1] != '/') {
+        --name;
+    }
+    len -= name - path;
+
+    if ((len == 0 || (len == 1 && name[0] == '.')) &&
+        getcwd(cwd, sizeof(cwd))) {
+        // current directory
+        name = strrchr(cwd, '/');
+        name = name ? name + 1 : cwd;
+        len = strlen(name);
+    }
+
+    snprintf(opts.caption, sizeof(opts.caption), "%.*s", (int)len, name);
+}
+
+/**
+ * Application entry point.
+ */
+int main(int argc, char* argv[])
+{
+    pthread_t threads[MAX_JOBS];
+    size_t num_threads = 0;
+    struct text* caption = NULL;
+    size_t skipped;
+    int argn;
+
+    argn = parse_cmdargs(argc, argv);
+    if (argc - argn != 2) {
+        print_help();
+        return EXIT_FAILURE;
+    }
+
+    opts.src_dir = argv[argn];
+    opts.dst_dir = argv[argn + 1];
+    if (mkdir(opts.dst_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Unable to create directory %s: [%d] %s\n",
+                opts.dst_dir, errno, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    set_caption(opts.src_dir);
+    if (opts.font && opts.caption[0]) {
+        font* fnt = font_load(opts.font, opts.font_size, NULL);
+        if (!fnt) {
+            return EXIT_FAILURE;
+        }
+        caption = font_render(fnt, opts.caption, CAPTION_SHADOW);
+        font_free(fnt);
+    }
+
+    if (!opts.jobs) {
+        const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        opts.jobs = cpus > 0 ? (size_t)cpus : 1;
+        if (opts.jobs > MAX_JOBS) {
+            opts.jobs = MAX_JOBS;
+        }
+    }
+
+    for (size_t i = 0; i < opts.jobs; ++i) {
+        if (pthread_create(&threads[num_threads], NULL, worker, caption) ==
+            0) {
+            ++num_threads;
+        }
+    }
+    if (!num_threads) {
+        fprintf(stderr, "Unable to create worker threads\n");
+        font_text_free(caption);
+        return EXIT_FAILURE;
+    }
+
+    skipped = scan_dir();
+    queue_close();
+
+    for (size_t i = 0; i < num_threads; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    font_text_free(caption);
+    pool_purge();
+
+    printf("Converted: %zu, failed: %zu, up to date: %zu\n",
+           queue.converted, queue.failed, skipped);
+
+    return queue.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
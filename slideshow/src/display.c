@@ -20,14 +20,27 @@
 #include <xf86drmMode.h>
 #pragma GCC diagnostic pop
 
+/** Display output. */
+struct output {
+    uint32_t conn_id;                  ///< Connector Id
+    uint32_t crtc_id;                  ///< CRTC Id
+    drmModeModeInfo mode;              ///< Output mode
+    drmModeCrtcPtr crtc_save;          ///< Previous CRTC mode
+    struct buffer fb[DISPLAY_BUFFERS]; ///< Frame buffers
+    size_t front;                      ///< Index of the displayed buffer
+    size_t queued;                     ///< Buffer to show after pending flip
+    bool pending;                      ///< Page flip is in progress
+    uint32_t plane_id;                 ///< Primary plane Id, 0 to flip CRTC
+    uint32_t prop_fb;                  ///< Plane property Id: FB_ID
+    uint32_t prop_damage;              ///< Plane property Id: FB_DAMAGE_CLIPS
+};
+
 /** Display context. */
 struct display {
-    int fd;                   ///< DRM file handle
-    uint32_t conn_id;         ///< Connector Id
-    uint32_t crtc_id;         ///< CRTC Id
-    drmModeCrtcPtr crtc_save; ///< Previous CRTC mode
-    struct buffer* cfb;       ///< Currently displayed frame buffers
-    struct buffer fb[2];      ///< Frame buffers
+    int fd;                                      ///< DRM file handle
+    bool atomic;                                 ///< Atomic API is enabled
+    struct output outputs[DISPLAY_MAX_OUTPUTS]; ///< Connected outputs
+    size_t num_outputs;                          ///< Number of outputs
 };
 
 /**
@@ -121,12 +134,210 @@ fail:
 }
 
 /**
- * Get first suitable connector.
+ * Get CRTC for the connector.
+ * @param display pointer to the display context
+ * @param res DRM resources
+ * @param conn connector description
+ * @return CRTC Id or 0 if no free CRTC is available
+ */
+static uint32_t get_crtc(const display* display, const drmModeRes* res,
+                         const drmModeConnector* conn)
+{
+    uint32_t crtc_id = 0;
+
+    for (int i = 0; !crtc_id && i < conn->count_encoders; ++i) {
+        drmModeEncoder* enc = drmModeGetEncoder(display->fd, conn->encoders[i]);
+        if (!enc) {
+            continue;
+        }
+        // try currently attached CRTC first, then any compatible one
+        for (int j = -1; !crtc_id && j < res->count_crtcs; ++j) {
+            uint32_t id;
+            if (j < 0) {
+                id = enc->crtc_id;
+            } else if (enc->possible_crtcs & (1 << j)) {
+                id = res->crtcs[j];
+            } else {
+                continue;
+            }
+            crtc_id = id;
+            for (size_t k = 0; crtc_id && k < display->num_outputs; ++k) {
+                if (display->outputs[k].crtc_id == crtc_id) {
+                    crtc_id = 0; // already in use
+                }
+            }
+        }
+        drmModeFreeEncoder(enc);
+    }
+
+    return crtc_id;
+}
+
+/**
+ * Schedule page flip with damage clips: outside the drawn areas both the
+ * displayed and the new frame buffers are black, so only these areas can
+ * differ.
+ * @param fd DRM file handle
+ * @param out output to flip
+ * @param index index of the frame buffer to show
+ * @return negative value on errors
+ */
+static int flip_damage(int fd, struct output* out, size_t index)
+{
+    const struct rect* areas[] = { &out->fb[out->front].drawn,
+                                   &out->fb[index].drawn };
+    struct drm_mode_rect clips[sizeof(areas) / sizeof(areas[0])];
+    size_t num_clips = 0;
+    uint32_t blob = 0;
+    drmModeAtomicReqPtr req;
+    int rc;
+
+    for (size_t i = 0; i < sizeof(areas) / sizeof(areas[0]); ++i) {
+        const struct rect* area = areas[i];
+        if (area->width && area->height) {
+            struct drm_mode_rect* clip = &clips[num_clips++];
+            clip->x1 = area->x;
+            clip->y1 = area->y;
+            clip->x2 = area->x + area->width;
+            clip->y2 = area->y + area->height;
+        }
+    }
+
+    req = drmModeAtomicAlloc();
+    if (!req) {
+        errno = ENOMEM;
+        return -1;
+    }
+    drmModeAtomicAddProperty(req, out->plane_id, out->prop_fb,
+                             out->fb[index].id);
+    // no clips means full update
+    if (num_clips &&
+        drmModeCreatePropertyBlob(fd, clips, num_clips * sizeof(clips[0]),
+                                  &blob) == 0) {
+        drmModeAtomicAddProperty(req, out->plane_id, out->prop_damage, blob);
+    }
+
+    rc = drmModeAtomicCommit(
+        fd, req, DRM_MODE_PAGE_FLIP_EVENT | DRM_MODE_ATOMIC_NONBLOCK, out);
+
+    drmModeAtomicFree(req);
+    if (blob) {
+        drmModeDestroyPropertyBlob(fd, blob);
+    }
+
+    return rc;
+}
+
+/**
+ * Schedule page flip.
+ * @param fd DRM file handle
+ * @param out output to flip
+ * @param index index of the frame buffer to show
+ */
+static void page_flip(int fd, struct output* out, size_t index)
+{
+    const int rc = out->plane_id
+        ? flip_damage(fd, out, index)
+        : drmModePageFlip(fd, out->crtc_id, out->fb[index].id,
+                          DRM_MODE_PAGE_FLIP_EVENT, out);
+    if (rc < 0) {
+        fprintf(stderr, "Unable to flip page: [%d] %s\n", errno,
+                strerror(errno));
+        return;
+    }
+    out->front = index;
+    out->pending = true;
+}
+
+/** Page flip event handler. */
+static void on_page_flip(int fd, __attribute__((unused)) unsigned int seq,
+                         __attribute__((unused)) unsigned int sec,
+                         __attribute__((unused)) unsigned int usec, void* data)
+{
+    struct output* out = data;
+
+    out->pending = false;
+
+    if (out->queued != DISPLAY_BUFFERS) {
+        const size_t index = out->queued;
+        out->queued = DISPLAY_BUFFERS;
+        if (index != out->front) {
+            page_flip(fd, out, index);
+        }
+    }
+}
+
+/**
+ * Find connector mode.
+ * @param conn connector description
+ * @param pref requested display mode, all zero for the default mode
+ * @return pointer to the connector mode or NULL if not supported
+ */
+static const drmModeModeInfo* find_mode(const drmModeConnector* conn,
+                                        const struct display_mode* pref)
+{
+    const drmModeModeInfo* mode = NULL;
+
+    if (!pref->width && !pref->height && !pref->rate) {
+        return &conn->modes[0];
+    }
+
+    // preferred timing or the highest refresh rate of the requested size
+    for (int i = 0; i < conn->count_modes; ++i) {
+        const drmModeModeInfo* cur = &conn->modes[i];
+        if ((pref->width && pref->width != cur->hdisplay) ||
+            (pref->height && pref->height != cur->vdisplay) ||
+            (pref->rate && pref->rate != cur->vrefresh) ||
+            (cur->flags & DRM_MODE_FLAG_INTERLACE)) {
+            continue;
+        }
+        if (cur->type & DRM_MODE_TYPE_PREFERRED) {
+            return cur;
+        }
+        if (!mode || cur->vrefresh > mode->vrefresh) {
+            mode = cur;
+        }
+    }
+
+    return mode;
+}
+
+/**
+ * Select connector mode.
+ * @param conn connector description
+ * @param modes preferred display modes in order of priority
+ * @param num number of modes in the array
+ * @return pointer to the connector mode
+ */
+static const drmModeModeInfo* select_mode(const drmModeConnector* conn,
+                                          const struct display_mode* modes,
+                                          size_t num)
+{
+    for (size_t i = 0; i < num; ++i) {
+        const drmModeModeInfo* mode = find_mode(conn, &modes[i]);
+        if (mode) {
+            return mode;
+        }
+    }
+
+    if (num) {
+        fprintf(stderr, "Mode %zux%zu@%zu is not supported by output %u\n",
+                modes[0].width, modes[0].height, modes[0].rate,
+                conn->connector_id);
+    }
+
+    return &conn->modes[0];
+}
+
+/**
+ * Get all connected connectors.
  * @param display pointer to the display context
- * @param mode output mode
- * @return true if connector found
+ * @param modes preferred display modes in order of priority
+ * @param num number of modes in the array
+ * @return true if at least one connector found
  */
-static bool get_connector(display* display, drmModeModeInfo* mode)
+static bool get_connectors(display* display, const struct display_mode* modes,
+                           size_t num)
 {
     drmModeRes* res = drmModeGetResources(display->fd);
     if (!res) {
@@ -135,45 +346,150 @@ static bool get_connector(display* display, drmModeModeInfo* mode)
         return false;
     }
 
-    for (int i = 0; i < res->count_connectors; ++i) {
+    for (int i = 0; i < res->count_connectors &&
+         display->num_outputs < DISPLAY_MAX_OUTPUTS;
+         ++i) {
+        struct output* out = &display->outputs[display->num_outputs];
         drmModeConnector* conn;
 
         conn = drmModeGetConnector(display->fd, res->connectors[i]);
         if (!conn) {
             continue;
         }
-        if (conn->connection != DRM_MODE_CONNECTED || conn->count_modes == 0) {
-            drmModeFreeConnector(conn);
+        if (conn->connection == DRM_MODE_CONNECTED && conn->count_modes > 0) {
+            out->crtc_id = get_crtc(display, res, conn);
+            if (out->crtc_id) {
+                out->mode = *select_mode(conn, modes, num);
+                out->conn_id = conn->connector_id;
+                ++display->num_outputs;
+            }
+        }
+        drmModeFreeConnector(conn);
+    }
+
+    drmModeFreeResources(res);
+
+    if (display->num_outputs == 0) {
+        fprintf(stderr, "Connector not found\n");
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Get plane type and Ids of properties used for page flips.
+ * @param display pointer to the display context
+ * @param plane_id plane Id
+ * @param out output to fill with properties Ids
+ * @return plane type
+ */
+static uint64_t get_plane_props(const display* display, uint32_t plane_id,
+                                struct output* out)
+{
+    uint64_t type = DRM_PLANE_TYPE_OVERLAY;
+    drmModeObjectPropertiesPtr props;
+
+    props = drmModeObjectGetProperties(display->fd, plane_id,
+                                       DRM_MODE_OBJECT_PLANE);
+    if (!props) {
+        return type;
+    }
+
+    for (uint32_t i = 0; i < props->count_props; ++i) {
+        drmModePropertyPtr prop = drmModeGetProperty(display->fd,
+                                                     props->props[i]);
+        if (!prop) {
             continue;
         }
+        if (strcmp(prop->name, "type") == 0) {
+            type = props->prop_values[i];
+        } else if (strcmp(prop->name, "FB_ID") == 0) {
+            out->prop_fb = prop->prop_id;
+        } else if (strcmp(prop->name, "FB_DAMAGE_CLIPS") == 0) {
+            out->prop_damage = prop->prop_id;
+        }
+        drmModeFreeProperty(prop);
+    }
 
-        for (int j = 0; j < conn->count_encoders; ++j) {
-            drmModeEncoder* enc;
-            enc = drmModeGetEncoder(display->fd, conn->encoders[j]);
-            if (!enc) {
-                continue;
+    drmModeFreeObjectProperties(props);
+
+    return type;
+}
+
+/**
+ * Find primary plane attached to the output CRTC, the plane is used for
+ * atomic page flips only if the driver supports damage clips.
+ * @param display pointer to the display context
+ * @param out output to setup
+ */
+static void find_plane(display* display, struct output* out)
+{
+    drmModePlaneResPtr res = drmModeGetPlaneResources(display->fd);
+
+    if (!res) {
+        return;
+    }
+
+    for (uint32_t i = 0; !out->plane_id && i < res->count_planes; ++i) {
+        drmModePlanePtr plane = drmModeGetPlane(display->fd, res->planes[i]);
+        if (!plane) {
+            continue;
+        }
+        if (plane->crtc_id == out->crtc_id) {
+            out->prop_fb = 0;
+            out->prop_damage = 0;
+            if (get_plane_props(display, plane->plane_id, out) ==
+                    DRM_PLANE_TYPE_PRIMARY &&
+                out->prop_fb && out->prop_damage) {
+                out->plane_id = plane->plane_id;
             }
-            // just get first available
-            *mode = conn->modes[0];
-            display->crtc_id = enc->crtc_id;
-            display->conn_id = conn->connector_id;
-            drmModeFreeEncoder(enc);
-            drmModeFreeConnector(conn);
-            drmModeFreeResources(res);
-            return true;
         }
-        drmModeFreeConnector(conn);
+        drmModeFreePlane(plane);
     }
 
-    drmModeFreeResources(res);
+    drmModeFreePlaneResources(res);
+}
 
-    fprintf(stderr, "Connector not found\n");
-    return false;
+/**
+ * Setup output: create frame buffers and set CRTC mode.
+ * @param display pointer to the display context
+ * @param out output to setup
+ * @return true if output is ready to use
+ */
+static bool setup_output(display* display, struct output* out)
+{
+    const size_t width = out->mode.hdisplay;
+    const size_t height = out->mode.vdisplay;
+
+    for (size_t i = 0; i < DISPLAY_BUFFERS; ++i) {
+        if (!create_fb(display, &out->fb[i], width, height)) {
+            return false;
+        }
+    }
+
+    // save the previous CRTC configuration
+    out->crtc_save = drmModeGetCrtc(display->fd, out->crtc_id);
+    // perform the modeset
+    out->front = 0;
+    out->queued = DISPLAY_BUFFERS;
+    if (drmModeSetCrtc(display->fd, out->crtc_id, out->fb[0].id, 0, 0,
+                       &out->conn_id, 1, &out->mode) < 0) {
+        fprintf(stderr, "Unable to set CRTC mode: [%d] %s\n", errno,
+                strerror(errno));
+        return false;
+    }
+
+    // the primary plane is attached to the CRTC by the modeset
+    if (display->atomic) {
+        find_plane(display, out);
+    }
+
+    return true;
 }
 
-display* display_init(void)
+display* display_init(const struct display_mode* modes, size_t num)
 {
-    drmModeModeInfo mode;
     display* display;
 
     display = calloc(1, sizeof(*display));
@@ -210,27 +526,20 @@ display* display_init(void)
         return NULL;
     }
 
-    if (!get_connector(display, &mode)) {
-        display_free(display);
-        return NULL;
-    }
+    // atomic API is used for page flips with damage clips
+    display->atomic =
+        drmSetClientCap(display->fd, DRM_CLIENT_CAP_ATOMIC, 1) == 0;
 
-    if (!create_fb(display, &display->fb[0], mode.hdisplay, mode.vdisplay) ||
-        !create_fb(display, &display->fb[1], mode.hdisplay, mode.vdisplay)) {
+    if (!get_connectors(display, modes, num)) {
         display_free(display);
         return NULL;
     }
 
-    // save the previous CRTC configuration
-    display->crtc_save = drmModeGetCrtc(display->fd, display->crtc_id);
-    // perform the modeset
-    display->cfb = &display->fb[0];
-    if (drmModeSetCrtc(display->fd, display->crtc_id, display->cfb->id, 0, 0,
-                       &display->conn_id, 1, &mode) < 0) {
-        fprintf(stderr, "Unable to set CRTC mode: [%d] %s\n", errno,
-                strerror(errno));
-        display_free(display);
-        return NULL;
+    for (size_t i = 0; i < display->num_outputs; ++i) {
+        if (!setup_output(display, &display->outputs[i])) {
+            display_free(display);
+            return NULL;
+        }
     }
 
     return display;
@@ -239,16 +548,20 @@ display* display_init(void)
 void display_free(display* display)
 {
     if (display) {
-        if (display->crtc_save) {
-            drmModeCrtcPtr crtc = display->crtc_save;
-            drmModeSetCrtc(display->fd, crtc->crtc_id, crtc->buffer_id, crtc->x,
-                           crtc->y, &display->conn_id, 1, &crtc->mode);
-            drmModeFreeCrtc(crtc);
+        for (size_t i = 0; i < display->num_outputs; ++i) {
+            struct output* out = &display->outputs[i];
+            if (out->crtc_save) {
+                drmModeCrtcPtr crtc = out->crtc_save;
+                drmModeSetCrtc(display->fd, crtc->crtc_id, crtc->buffer_id,
+                               crtc->x, crtc->y, &out->conn_id, 1,
+                               &crtc->mode);
+                drmModeFreeCrtc(crtc);
+            }
+            for (size_t j = 0; j < DISPLAY_BUFFERS; ++j) {
+                free_fb(display, &out->fb[j]);
+            }
         }
 
-        free_fb(display, &display->fb[0]);
-        free_fb(display, &display->fb[1]);
-
         if (display->fd != -1) {
             close(display->fd);
         }
@@ -257,23 +570,48 @@ void display_free(display* display)
     }
 }
 
-struct buffer* display_draw(display* display)
+size_t display_outputs(const display* display)
 {
-    return display->cfb;
+    return display->num_outputs;
 }
 
-void display_commit(display* display)
+int display_fd(const display* display)
 {
-    // swap buffers
-    if (drmModePageFlip(display->fd, display->crtc_id, display->cfb->id,
-                        DRM_MODE_PAGE_FLIP_EVENT, NULL) < 0) {
-        fprintf(stderr, "Unable to flip page: [%d] %s\n", errno,
-                strerror(errno));
+    return display->fd;
+}
+
+void display_handle(display* display)
+{
+    drmEventContext ctx = {
+        .version = DRM_EVENT_CONTEXT_VERSION,
+        .page_flip_handler = on_page_flip,
+    };
+    drmHandleEvent(display->fd, &ctx);
+}
+
+bool display_busy(const display* display)
+{
+    for (size_t i = 0; i < display->num_outputs; ++i) {
+        if (display->outputs[i].pending) {
+            return true;
+        }
     }
+    return false;
+}
+
+struct buffer* display_draw(display* display, size_t output, size_t index)
+{
+    return &display->outputs[output].fb[index];
+}
+
+void display_commit(display* display, size_t output, size_t index)
+{
+    struct output* out = &display->outputs[output];
 
-    if (display->cfb == &display->fb[0]) {
-        display->cfb = &display->fb[1];
-    } else {
-        display->cfb = &display->fb[0];
+    if (out->pending) {
+        // will be flipped as soon as the current flip is done
+        out->queued = index;
+    } else if (index != out->front) {
+        page_flip(display->fd, out, index);
     }
 }
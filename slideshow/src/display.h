@@ -4,28 +4,81 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
+/** Max number of simultaneously driven outputs. */
+#define DISPLAY_MAX_OUTPUTS 4
+
+/** Number of frame buffers per output. */
+#define DISPLAY_BUFFERS 4
+
+/** Display mode, zero fields match any value, all zero is the default mode. */
+struct display_mode {
+    size_t width;  ///< Horizontal resolution (pixels)
+    size_t height; ///< Vertical resolution (pixels)
+    size_t rate;   ///< Refresh rate (Hz)
+};
+
 /** Display context. */
 typedef struct display display;
 
+/** Rectangle. */
+struct rect {
+    size_t x;      ///< Left position
+    size_t y;      ///< Top position
+    size_t width;  ///< Width
+    size_t height; ///< Height
+};
+
+/**
+ * Extend rectangle to cover another one.
+ * @param dst rectangle to extend
+ * @param src rectangle to cover
+ */
+static inline void rect_join(struct rect* dst, const struct rect* src)
+{
+    if (!src->width || !src->height) {
+        return;
+    }
+    if (!dst->width || !dst->height) {
+        *dst = *src;
+    } else {
+        const size_t right = dst->x + dst->width > src->x + src->width
+            ? dst->x + dst->width
+            : src->x + src->width;
+        const size_t bottom = dst->y + dst->height > src->y + src->height
+            ? dst->y + dst->height
+            : src->y + src->height;
+        dst->x = dst->x < src->x ? dst->x : src->x;
+        dst->y = dst->y < src->y ? dst->y : src->y;
+        dst->width = right - dst->x;
+        dst->height = bottom - dst->y;
+    }
+}
+
 /** Display frame buffer. */
 struct buffer {
-    uint8_t* data;   ///< Buffer data
-    size_t width;    ///< Buffer width (pixels)
-    size_t height;   ///< Buffer height (pixels)
-    size_t stride;   ///< Stride size in bytes
-    size_t size;     ///< Total size of the buffer (bytes)
-    uint32_t id;     ///< Buffer Id (DRM specific)
-    uint32_t handle; ///< Buffer handle (DRM specific)
+    uint8_t* data;     ///< Buffer data
+    size_t width;      ///< Buffer width (pixels)
+    size_t height;     ///< Buffer height (pixels)
+    size_t stride;     ///< Stride size in bytes
+    size_t size;       ///< Total size of the buffer (bytes)
+    struct rect drawn; ///< Drawn area, the rest of the buffer is black
+    uint32_t id;       ///< Buffer Id (DRM specific)
+    uint32_t handle;   ///< Buffer handle (DRM specific)
 };
 
 /**
  * Initialize display.
+ * @param modes preferred display modes in order of priority: each output uses
+ *              the first one it supports, or its default mode if none is
+ *              supported
+ * @param num number of modes in the array, 0 to use the default mode
  * @return display context or NULL if error
  */
-display* display_init(void);
+display* display_init(const struct display_mode* modes, size_t num);
 
 /**
  * Destroy display context.
@@ -34,14 +87,49 @@ display* display_init(void);
 void display_free(display* display);
 
 /**
- * Begin drawing.
+ * Get number of connected outputs.
+ * @param display pointer to the display context
+ * @return number of outputs
+ */
+size_t display_outputs(const display* display);
+
+/**
+ * Get DRM file descriptor to poll for display events.
+ * @param display pointer to the display context
+ * @return file descriptor
+ */
+int display_fd(const display* display);
+
+/**
+ * Handle pending display events (page flip completion).
+ * @param display pointer to the display context
+ */
+void display_handle(display* display);
+
+/**
+ * Check if any of outputs is waiting for the page flip.
+ * @param display pointer to the display context
+ * @return true if page flip is in progress
+ */
+bool display_busy(const display* display);
+
+/**
+ * Get frame buffer for drawing.
+ * The buffer must not be currently displayed, see display_commit().
  * @param display pointer to the display context
- * @return pointer to the current frame buffer
+ * @param output output index
+ * @param index frame buffer index, [0, DISPLAY_BUFFERS)
+ * @return pointer to the frame buffer
  */
-struct buffer* display_draw(display* display);
+struct buffer* display_draw(display* display, size_t output, size_t index);
 
 /**
- * Flush frame buffer to display.
+ * Show frame buffer on the output, the page flip is scheduled on the next
+ * vblank or queued if the previous flip is still in progress.
+ * Only the drawn areas of the new and the displayed buffers are reported to
+ * the driver as damaged, see struct buffer.
  * @param display pointer to the display context
+ * @param output output index
+ * @param index frame buffer index
  */
-void display_commit(display* display);
+void display_commit(display* display, size_t output, size_t index);
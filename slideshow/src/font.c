@@ -0,0 +1,543 @@
+// SPDX-License-Identifier: MIT
+// Text rendering.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#include "font.h"
+
+#include "blur.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+/** Shadow opacity (0-255). */
+#define SHADOW_OPACITY 204
+
+/** Width of the glyph atlas (pixels). */
+#define ATLAS_WIDTH 1024
+
+/** Signature of the font cache file. */
+#define CACHE_MAGIC 0x534c4653
+
+/** Replacement for characters that are not in the atlas. */
+#define MISSING_CHAR '?'
+
+/** Ranges of the pre-rasterized characters. */
+// clang-format off
+static const uint32_t charset[][2] = {
+    { 0x0020, 0x007e }, // Basic Latin
+    { 0x00a0, 0x017f }, // Latin-1 Supplement, Latin Extended-A
+    { 0x0400, 0x045f }, // Cyrillic
+    { 0x2010, 0x2026 }, // General Punctuation
+};
+// clang-format on
+
+/** Rasterized glyph. */
+struct glyph {
+    uint32_t code;    ///< Unicode code point
+    int32_t left;     ///< Horizontal offset from the pen position
+    int32_t top;      ///< Vertical offset from the baseline
+    uint32_t advance; ///< Horizontal advance
+    uint32_t width;   ///< Bitmap width
+    uint32_t height;  ///< Bitmap height
+    uint32_t x;       ///< Horizontal position of the bitmap in the atlas
+    uint32_t y;       ///< Vertical position of the bitmap in the atlas
+};
+
+/** Header of the font cache file, followed by glyphs and atlas data. */
+struct cache_header {
+    uint32_t magic;        ///< File signature
+    uint32_t glyph_size;   ///< Size of the glyph description
+    uint64_t font_mtime;   ///< Modification time of the font file
+    uint64_t font_size;    ///< Size of the font file
+    uint32_t size;         ///< Font size (pixels)
+    uint32_t ascender;     ///< Distance from the top to the baseline
+    uint32_t height;       ///< Line height
+    uint32_t num_glyphs;   ///< Number of glyphs
+    uint32_t atlas_height; ///< Height of the atlas
+};
+
+/** Font context. */
+struct font {
+    size_t ascender;      ///< Distance from the top to the baseline
+    size_t height;        ///< Line height
+    struct glyph* glyphs; ///< Glyphs sorted by code point
+    size_t num_glyphs;    ///< Number of glyphs
+    uint8_t* atlas;       ///< Alpha bitmaps of all glyphs, ATLAS_WIDTH wide
+    size_t atlas_height;  ///< Height of the atlas
+};
+
+/**
+ * Decode next UTF-8 character.
+ * @param str pointer to the string, moved to the next character
+ * @return Unicode code point
+ */
+static uint32_t utf8_next(const char** str)
+{
+    const uint8_t* ptr = (const uint8_t*)*str;
+    uint32_t code = *ptr++;
+    size_t len = 0;
+
+    if (code >= 0xf0) {
+        code &= 0x07;
+        len = 3;
+    } else if (code >= 0xe0) {
+        code &= 0x0f;
+        len = 2;
+    } else if (code >= 0xc0) {
+        code &= 0x1f;
+        len = 1;
+    }
+    while (len-- && (*ptr & 0xc0) == 0x80) {
+        code = (code << 6) | (*ptr++ & 0x3f);
+    }
+
+    *str = (const char*)ptr;
+    return code;
+}
+
+/**
+ * Get glyph from the atlas.
+ * @param fnt font context
+ * @param code Unicode code point
+ * @return pointer to the glyph or NULL if it's not in the atlas
+ */
+static const struct glyph* get_glyph(const font* fnt, uint32_t code)
+{
+    size_t lo = 0;
+    size_t hi = fnt->num_glyphs;
+
+    // binary search, glyphs are sorted by code point
+    while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        const struct glyph* glyph = &fnt->glyphs[mid];
+        if (glyph->code == code) {
+            return glyph;
+        }
+        if (glyph->code < code) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return code == MISSING_CHAR ? NULL : get_glyph(fnt, MISSING_CHAR);
+}
+
+/** Position of the next glyph in the atlas. */
+struct atlas_pen {
+    size_t x;      ///< Horizontal position
+    size_t y;      ///< Top of the current row
+    size_t height; ///< Height of the current row
+};
+
+/**
+ * Put glyph bitmap to the atlas.
+ * @param fnt font context
+ * @param glyph glyph description, position is set by this function
+ * @param bitmap rasterized glyph
+ * @param pen position of the next glyph in the atlas
+ * @return false if not enough memory
+ */
+static bool put_glyph(font* fnt, struct glyph* glyph, const FT_Bitmap* bitmap,
+                      struct atlas_pen* pen)
+{
+    // simple shelf packing: glyphs are placed left to right in rows
+    if (pen->x + glyph->width > ATLAS_WIDTH) {
+        pen->x = 0;
+        pen->y += pen->height;
+        pen->height = 0;
+    }
+    glyph->x = pen->x;
+    glyph->y = pen->y;
+    pen->x += glyph->width;
+    if (pen->height < glyph->height) {
+        pen->height = glyph->height;
+    }
+
+    if (glyph->y + glyph->height > fnt->atlas_height) {
+        const size_t height = glyph->y + glyph->height * 4;
+        uint8_t* atlas = realloc(fnt->atlas, height * ATLAS_WIDTH);
+        if (!atlas) {
+            return false;
+        }
+        memset(atlas + fnt->atlas_height * ATLAS_WIDTH, 0,
+               (height - fnt->atlas_height) * ATLAS_WIDTH);
+        fnt->atlas = atlas;
+        fnt->atlas_height = height;
+    }
+
+    for (size_t y = 0; y < glyph->height; ++y) {
+        memcpy(&fnt->atlas[(glyph->y + y) * ATLAS_WIDTH + glyph->x],
+               bitmap->buffer + y * bitmap->pitch, glyph->width);
+    }
+
+    return true;
+}
+
+/**
+ * Rasterize all glyphs of the character set to the atlas.
+ * @param fnt font context
+ * @param path path to the font file
+ * @param size font size (pixels)
+ * @return false on errors
+ */
+static bool rasterize(font* fnt, const char* path, size_t size)
+{
+    FT_Library lib = NULL;
+    FT_Face face = NULL;
+    struct atlas_pen pen = { 0 };
+    size_t max_glyphs = 0;
+    bool rc = false;
+
+    if (FT_Init_FreeType(&lib) != 0 ||
+        FT_New_Face(lib, path, 0, &face) != 0 ||
+        FT_Set_Pixel_Sizes(face, 0, size) != 0) {
+        goto done;
+    }
+
+    fnt->ascender = face->size->metrics.ascender >> 6;
+    fnt->height =
+        (face->size->metrics.ascender - face->size->metrics.descender) >> 6;
+
+    for (size_t i = 0; i < sizeof(charset) / sizeof(charset[0]); ++i) {
+        max_glyphs += charset[i][1] - charset[i][0] + 1;
+    }
+    fnt->glyphs = malloc(max_glyphs * sizeof(*fnt->glyphs));
+    if (!fnt->glyphs) {
+        goto done;
+    }
+
+    for (size_t i = 0; i < sizeof(charset) / sizeof(charset[0]); ++i) {
+        for (uint32_t code = charset[i][0]; code <= charset[i][1]; ++code) {
+            struct glyph* glyph = &fnt->glyphs[fnt->num_glyphs];
+            FT_GlyphSlot slot;
+
+            if (FT_Get_Char_Index(face, code) == 0 ||
+                FT_Load_Char(face, code, FT_LOAD_RENDER) != 0) {
+                continue; // not supported by the font
+            }
+            slot = face->glyph;
+
+            glyph->code = code;
+            glyph->left = slot->bitmap_left;
+            glyph->top = slot->bitmap_top;
+            glyph->advance = slot->advance.x >> 6;
+            glyph->width = slot->bitmap.width;
+            glyph->height = slot->bitmap.rows;
+            if (glyph->width > ATLAS_WIDTH ||
+                !put_glyph(fnt, glyph, &slot->bitmap, &pen)) {
+                goto done;
+            }
+            ++fnt->num_glyphs;
+        }
+    }
+
+    // trim unused space
+    fnt->atlas_height = pen.y + pen.height;
+    rc = true;
+
+done:
+    if (face) {
+        FT_Done_Face(face);
+    }
+    if (lib) {
+        FT_Done_FreeType(lib);
+    }
+    return rc;
+}
+
+/**
+ * Fill cache header for the font.
+ * @param path path to the font file
+ * @param size font size (pixels)
+ * @param hdr header to fill
+ * @return false if font file doesn't exist
+ */
+static bool cache_header(const char* path, size_t size,
+                         struct cache_header* hdr)
+{
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        return false;
+    }
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = CACHE_MAGIC;
+    hdr->glyph_size = sizeof(struct glyph);
+    hdr->font_mtime = st.st_mtime;
+    hdr->font_size = st.st_size;
+    hdr->size = size;
+
+    return true;
+}
+
+/**
+ * Load glyphs from the cache file.
+ * @param fnt font context
+ * @param cache path to the cache file
+ * @param expect expected header of the cache file
+ * @return false if cache is absent or outdated
+ */
+static bool load_cache(font* fnt, const char* cache,
+                       const struct cache_header* expect)
+{
+    struct cache_header hdr;
+    FILE* file;
+    bool rc = false;
+
+    file = fopen(cache, "rb");
+    if (!file) {
+        return false;
+    }
+
+    if (fread(&hdr, sizeof(hdr), 1, file) != 1 ||
+        hdr.magic != expect->magic || hdr.glyph_size != expect->glyph_size ||
+        hdr.font_mtime != expect->font_mtime ||
+        hdr.font_size != expect->font_size || hdr.size != expect->size) {
+        goto done;
+    }
+
+    fnt->ascender = hdr.ascender;
+    fnt->height = hdr.height;
+    fnt->num_glyphs = hdr.num_glyphs;
+    fnt->atlas_height = hdr.atlas_height;
+    fnt->glyphs = malloc(fnt->num_glyphs * sizeof(*fnt->glyphs));
+    fnt->atlas = malloc(fnt->atlas_height * ATLAS_WIDTH);
+    if (!fnt->glyphs || !fnt->atlas) {
+        goto done;
+    }
+    if (fread(fnt->glyphs, sizeof(*fnt->glyphs), fnt->num_glyphs, file) !=
+            fnt->num_glyphs ||
+        fread(fnt->atlas, ATLAS_WIDTH, fnt->atlas_height, file) !=
+            fnt->atlas_height) {
+        goto done;
+    }
+
+    // validate glyph positions
+    for (size_t i = 0; i < fnt->num_glyphs; ++i) {
+        const struct glyph* glyph = &fnt->glyphs[i];
+        if (glyph->x + glyph->width > ATLAS_WIDTH ||
+            glyph->y + glyph->height > fnt->atlas_height) {
+            goto done;
+        }
+    }
+
+    rc = true;
+
+done:
+    fclose(file);
+    if (!rc) {
+        free(fnt->glyphs);
+        free(fnt->atlas);
+        fnt->glyphs = NULL;
+        fnt->atlas = NULL;
+        fnt->num_glyphs = 0;
+        fnt->atlas_height = 0;
+    }
+    return rc;
+}
+
+/**
+ * Save glyphs to the cache file.
+ * @param fnt font context
+ * @param cache path to the cache file
+ * @param hdr header of the cache file
+ */
+static void save_cache(const font* fnt, const char* cache,
+                       struct cache_header* hdr)
+{
+    FILE* file;
+    bool rc;
+
+    hdr->ascender = fnt->ascender;
+    hdr->height = fnt->height;
+    hdr->num_glyphs = fnt->num_glyphs;
+    hdr->atlas_height = fnt->atlas_height;
+
+    // cache is optional, the directory can be read-only
+    file = fopen(cache, "wb");
+    if (!file) {
+        return;
+    }
+
+    rc = fwrite(hdr, sizeof(*hdr), 1, file) == 1 &&
+        fwrite(fnt->glyphs, sizeof(*fnt->glyphs), fnt->num_glyphs, file) ==
+            fnt->num_glyphs &&
+        fwrite(fnt->atlas, ATLAS_WIDTH, fnt->atlas_height, file) ==
+            fnt->atlas_height;
+    if (fclose(file) != 0 || !rc) {
+        remove(cache);
+    }
+}
+
+/**
+ * Blend color with alpha.
+ * @param dst destination pixel
+ * @param color color to put
+ * @param alpha alpha value
+ * @return blended pixel
+ */
+static inline xrgb_t alpha_blend(xrgb_t dst, xrgb_t color, uint32_t alpha)
+{
+    const uint32_t na = 255 - alpha;
+    uint32_t rb = (color & 0xff00ff) * alpha + (dst & 0xff00ff) * na;
+    uint32_t g = (color & 0x00ff00) * alpha + (dst & 0x00ff00) * na;
+    // fast division by 255
+    rb = ((rb + 0x010001 + ((rb >> 8) & 0xff00ff)) >> 8) & 0xff00ff;
+    g = ((g + 0x000100 + ((g >> 8) & 0x00ff00)) >> 8) & 0x00ff00;
+    return ((xrgb_t)0xff << 24) | rb | g;
+}
+
+font* font_load(const char* path, size_t size, const char* cache)
+{
+    struct cache_header hdr;
+    font* fnt;
+
+    fnt = calloc(1, sizeof(*fnt));
+    if (!fnt) {
+        fprintf(stderr, "Not enough memory\n");
+        return NULL;
+    }
+
+    if (!cache_header(path, size, &hdr)) {
+        fprintf(stderr, "Font file %s not found\n", path);
+        font_free(fnt);
+        return NULL;
+    }
+
+    if (!cache || !load_cache(fnt, cache, &hdr)) {
+        if (!rasterize(fnt, path, size)) {
+            fprintf(stderr, "Unable to load font %s\n", path);
+            font_free(fnt);
+            return NULL;
+        }
+        if (cache) {
+            save_cache(fnt, cache, &hdr);
+        }
+    }
+
+    return fnt;
+}
+
+void font_free(font* fnt)
+{
+    if (fnt) {
+        free(fnt->glyphs);
+        free(fnt->atlas);
+        free(fnt);
+    }
+}
+
+struct text* font_render(const font* fnt, const char* str, float shadow)
+{
+    const size_t pad = shadow * 3;
+    struct text* text;
+    size_t width = 0;
+    size_t size;
+    size_t pen;
+
+    // get text width
+    for (const char* ptr = str; *ptr;) {
+        const struct glyph* glyph = get_glyph(fnt, utf8_next(&ptr));
+        if (glyph) {
+            width += glyph->advance;
+        }
+    }
+
+    text = calloc(1, sizeof(*text));
+    if (!text) {
+        return NULL;
+    }
+    text->width = width + pad * 2;
+    text->height = fnt->height + pad * 2;
+    size = text->width * text->height;
+    text->alpha = calloc(1, shadow > 0 ? size * 2 : size);
+    if (!text->alpha) {
+        free(text);
+        return NULL;
+    }
+
+    // put glyphs to the mask
+    pen = pad;
+    for (const char* ptr = str; *ptr;) {
+        const struct glyph* glyph = get_glyph(fnt, utf8_next(&ptr));
+        if (!glyph) {
+            continue;
+        }
+        for (size_t y = 0; y < glyph->height; ++y) {
+            const int ty = (int)(pad + fnt->ascender) - glyph->top + (int)y;
+            const uint8_t* src =
+                &fnt->atlas[(glyph->y + y) * ATLAS_WIDTH + glyph->x];
+            if (ty < 0 || (size_t)ty >= text->height) {
+                continue;
+            }
+            for (size_t x = 0; x < glyph->width; ++x) {
+                const int tx = (int)pen + glyph->left + (int)x;
+                if (tx >= 0 && (size_t)tx < text->width) {
+                    uint8_t* dst = &text->alpha[ty * text->width + tx];
+                    if (src[x] > *dst) {
+                        *dst = src[x];
+                    }
+                }
+            }
+        }
+        pen += glyph->advance;
+    }
+
+    // create shadow
+    if (shadow > 0) {
+        text->shadow = text->alpha + size;
+        for (size_t i = 0; i < size; ++i) {
+            text->shadow[i] = (text->alpha[i] * SHADOW_OPACITY) / 255;
+        }
+        blur(text->shadow, text->width, text->height, text->width, 1, shadow);
+    }
+
+    return text;
+}
+
+void font_text_free(struct text* text)
+{
+    if (text) {
+        free(text->alpha);
+        free(text);
+    }
+}
+
+void font_draw(const struct text* text, struct buffer* fb, size_t x, size_t y,
+               xrgb_t color)
+{
+    struct rect area = { x, y, text->width, text->height };
+
+    if (x >= fb->width || y >= fb->height) {
+        return;
+    }
+    if (area.width > fb->width - x) {
+        area.width = fb->width - x;
+    }
+    if (area.height > fb->height - y) {
+        area.height = fb->height - y;
+    }
+    rect_join(&fb->drawn, &area);
+
+    for (size_t ty = 0; ty < text->height && y + ty < fb->height; ++ty) {
+        xrgb_t* dst = (xrgb_t*)(fb->data + (y + ty) * fb->stride) + x;
+        const uint8_t* alpha = &text->alpha[ty * text->width];
+        const uint8_t* shadow =
+            text->shadow ? &text->shadow[ty * text->width] : NULL;
+        for (size_t tx = 0; tx < text->width && x + tx < fb->width; ++tx) {
+            if (shadow && shadow[tx]) {
+                dst[tx] = alpha_blend(dst[tx], 0, shadow[tx]);
+            }
+            if (alpha[tx]) {
+                dst[tx] = alpha_blend(dst[tx], color, alpha[tx]);
+            }
+        }
+    }
+}
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: MIT
+// Text rendering.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#pragma once
+
+#include "display.h"
+#include "image.h"
+
+/** Font context. */
+typedef struct font font;
+
+/** Rendered text. */
+struct text {
+    size_t width;    ///< Width of the text box (pixels)
+    size_t height;   ///< Height of the text box (pixels)
+    uint8_t* alpha;  ///< Text alpha mask
+    uint8_t* shadow; ///< Shadow alpha mask, NULL if shadow is disabled
+};
+
+/**
+ * Load font: glyphs of the supported character set are rasterized once to
+ * the alpha atlas, the font context is read only after loading and can be
+ * shared between threads.
+ * @param path path to the font file
+ * @param size font size (pixels)
+ * @param cache path to the atlas cache file, NULL to disable cache
+ * @return font context or NULL if error
+ */
+font* font_load(const char* path, size_t size, const char* cache);
+
+/**
+ * Destroy font context.
+ * @param fnt font context
+ */
+void font_free(font* fnt);
+
+/**
+ * Render text to alpha mask.
+ * @param fnt font context
+ * @param str UTF-8 string to render
+ * @param shadow shadow blur radius (sigma), 0 to disable shadow
+ * @return rendered text or NULL on errors
+ */
+struct text* font_render(const font* fnt, const char* str, float shadow);
+
+/**
+ * Free rendered text.
+ * @param text rendered text
+ */
+void font_text_free(struct text* text);
+
+/**
+ * Draw rendered text on the frame buffer.
+ * @param text rendered text
+ * @param fb destination frame buffer
+ * @param x,y top left position of the text box
+ * @param color text color
+ */
+void font_draw(const struct text* text, struct buffer* fb, size_t x, size_t y,
+               xrgb_t color);
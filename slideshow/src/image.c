@@ -1,102 +1,322 @@
 // SPDX-License-Identifier: MIT
-// Image loader.
+// Image loader and writer.
 // Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
 
 #include "image.h"
 
-#include <setjmp.h>
+#include "codec.h"
+#include "pool.h"
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
-// depends on stdio.h, uses FILE but doesn't include the header
-#include <jpeglib.h>
+/** Max number of pixels in the image, larger images are rejected. */
+#define MAX_PIXELS (64 * 1000 * 1000)
 
-struct jpg_error_manager {
-    struct jpeg_error_mgr mgr;
-    jmp_buf setjmp;
+/** Supported image formats. */
+static const struct codec* const codecs[] = {
+    &codec_jpeg,
+#ifdef HAVE_PNG
+    &codec_png,
+#endif
+#ifdef HAVE_WEBP
+    &codec_webp,
+#endif
 };
 
-/** JPEG error handler. */
-static void jpg_error_exit(j_common_ptr jpg)
+uint64_t codec_time(void)
 {
-    struct jpg_error_manager* err = (struct jpg_error_manager*)jpg->err;
-    char msg[JMSG_LENGTH_MAX] = { 0 };
-    (*(jpg->err->format_message))(jpg, msg);
-    longjmp(err->setjmp, 1);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
-struct image* image_load(const char* path)
+/**
+ * Detect image format by the file signature.
+ * @param file source file, the position is reset to the beginning
+ * @return decoder or NULL if format is not supported
+ */
+static const struct codec* detect(FILE* file)
 {
-    struct image* img = NULL;
+    uint8_t sig[CODEC_SIGNATURE];
+    const size_t size = fread(sig, 1, sizeof(sig), file);
+
+    if (fseek(file, 0, SEEK_SET) != 0) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < sizeof(codecs) / sizeof(codecs[0]); ++i) {
+        if (codecs[i]->match(sig, size)) {
+            return codecs[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Close image that failed to open.
+ * @param img image instance
+ * @param corrupt optional output flag of invalid image data
+ */
+static void open_failed(struct image* img, bool* corrupt)
+{
+    if (corrupt) {
+        *corrupt = img->corrupt;
+    }
+    image_close(img);
+}
+
+/**
+ * Open image file and read its header.
+ * @param path path to the image file
+ * @param corrupt optional output flag of invalid image data
+ * @return image instance or NULL on errors
+ */
+static struct image* open_header(const char* path, bool* corrupt)
+{
+    const struct codec* codec;
+    struct image* img;
     FILE* file;
-    struct jpeg_decompress_struct jpg;
-    struct jpg_error_manager err;
 
-    // open image file
     file = fopen(path, "rb");
     if (!file) {
         return NULL;
     }
 
-    // setup error handling
-    jpg.err = jpeg_std_error(&err.mgr);
-    err.mgr.error_exit = jpg_error_exit;
-    if (setjmp(err.setjmp)) {
-        free(img);
-        if (file) {
-            fclose(file);
-        }
-        jpeg_destroy_decompress(&jpg);
+    codec = detect(file);
+    if (!codec) {
+        fclose(file);
         return NULL;
     }
 
-    // initialize jpeg decoder
-    jpeg_create_decompress(&jpg);
-    jpeg_stdio_src(&jpg, file);
-    jpeg_read_header(&jpg, TRUE);
-    jpg.out_color_space = JCS_RGB;
-    jpeg_start_decompress(&jpg);
-
-    // allocate image data buffer
-    img = malloc(sizeof(*img) +
-                 jpg.output_width * jpg.output_height * sizeof(xrgb_t));
+    img = calloc(1, sizeof(*img) + codec->context);
     if (!img) {
-        jpeg_destroy_decompress(&jpg);
         fclose(file);
         return NULL;
     }
-    img->data = (xrgb_t*)((uint8_t*)img + sizeof(*img));
-    img->width = jpg.output_width;
-    img->height = jpg.output_height;
-
-    // decode image
-    while (jpg.output_scanline < jpg.output_height) {
-        uint8_t* line =
-            (uint8_t*)&img->data[jpg.output_scanline * jpg.output_width];
-        jpeg_read_scanlines(&jpg, &line, 1);
-
-        // convert to 32-bit xrgb
-        if (jpg.out_color_components == 1) {
-            uint32_t* pixel = (uint32_t*)line;
-            for (int x = jpg.output_width - 1; x >= 0; --x) {
-                const xrgb_t c = *(line + x);
-                pixel[x] = ((xrgb_t)0xff << 24) | (c << 16) | (c << 8) | c;
-            }
-        } else if (jpg.out_color_components == 3) {
-            uint32_t* pixel = (uint32_t*)line;
-            for (int x = jpg.output_width - 1; x >= 0; --x) {
-                const uint8_t* src = line + x * 3;
-                const xrgb_t r = src[0];
-                const xrgb_t g = src[1];
-                const xrgb_t b = src[2];
-                pixel[x] = ((xrgb_t)0xff << 24) | (r << 16) | (g << 8) | b;
-            }
+    img->decoder = (uint8_t*)img + sizeof(*img);
+    img->codec = codec;
+
+    // decoder owns the file from now on
+    if (!codec->open(img, file)) {
+        open_failed(img, corrupt);
+        return NULL;
+    }
+
+    return img;
+}
+
+bool image_detect(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    bool rc = false;
+
+    if (file) {
+        rc = detect(file) != NULL;
+        fclose(file);
+    }
+
+    return rc;
+}
+
+/**
+ * Decode the whole image and rotate or flip it according to its EXIF
+ * orientation, the result is provided as raw pixels.
+ * @param img image instance
+ * @return false on decoding errors
+ */
+static bool apply_orientation(struct image* img)
+{
+    const size_t width = img->width;
+    const size_t height = img->height;
+    const bool transpose = img->orientation >= 5;
+    const size_t out_w = transpose ? height : width;
+    const size_t out_h = transpose ? width : height;
+    const ptrdiff_t last_x = width - 1;
+    const ptrdiff_t last_y = (ptrdiff_t)(height - 1) * width;
+    ptrdiff_t base, dx, dy;
+    xrgb_t* src;
+    xrgb_t* dst;
+
+    // source and oriented copies, keep original orientation if too large
+    if (height > CODEC_MAX_BUFFER / 2 / (width * sizeof(xrgb_t))) {
+        return true;
+    }
+    src = pool_alloc(width * height * sizeof(xrgb_t));
+    dst = pool_alloc(width * height * sizeof(xrgb_t));
+    if (!src || !dst) {
+        pool_free(src);
+        pool_free(dst);
+        return true;
+    }
+
+    while (img->row < height) {
+        if (!image_read(img, src + img->row * width)) {
+            pool_free(src);
+            pool_free(dst);
+            return false;
+        }
+    }
+
+    // position of the oriented pixel in the source image
+    switch (img->orientation) {
+        case 2: // mirror horizontal
+            base = last_x, dx = -1, dy = width;
+            break;
+        case 3: // rotate 180
+            base = last_y + last_x, dx = -1, dy = -(ptrdiff_t)width;
+            break;
+        case 4: // mirror vertical
+            base = last_y, dx = 1, dy = -(ptrdiff_t)width;
+            break;
+        case 5: // transpose
+            base = 0, dx = width, dy = 1;
+            break;
+        case 6: // rotate 90 clockwise
+            base = last_y, dx = -(ptrdiff_t)width, dy = 1;
+            break;
+        case 7: // transverse
+            base = last_y + last_x, dx = -(ptrdiff_t)width, dy = -1;
+            break;
+        default: // rotate 90 counterclockwise
+            base = last_x, dx = width, dy = -1;
+            break;
+    }
+    for (size_t y = 0; y < out_h; ++y) {
+        const ptrdiff_t row = base + (ptrdiff_t)y * dy;
+        xrgb_t* line = dst + y * out_w;
+        for (size_t x = 0; x < out_w; ++x) {
+            line[x] = src[row + (ptrdiff_t)x * dx];
         }
     }
+    pool_free(src);
+
+    img->buffer = dst;
+    img->pixels = (const uint8_t*)dst;
+    img->stride = out_w * sizeof(xrgb_t);
+    img->width = out_w;
+    img->height = out_h;
+    img->row = 0;
 
-    jpeg_finish_decompress(&jpg);
-    jpeg_destroy_decompress(&jpg);
-    fclose(file);
+    return true;
+}
+
+struct image* image_open(const char* path, size_t width, size_t height,
+                         bool orient, bool* corrupt)
+{
+    struct image* img;
+    uint64_t start;
+
+    if (corrupt) {
+        *corrupt = false;
+    }
+
+    img = open_header(path, corrupt);
+    if (!img) {
+        return NULL;
+    }
+
+    // the image is decoded row by row and can be downscaled by the decoder,
+    // but huge images still take too much time and memory
+    if ((uint64_t)img->width * img->height > MAX_PIXELS) {
+        fprintf(stderr, "Image is too large: %s (%zux%zu)\n", path,
+                img->width, img->height);
+        image_close(img);
+        return NULL;
+    }
+
+    orient = orient && img->orientation > 1;
+    if (orient && img->orientation >= 5) {
+        // the image is transposed, so is the size hint
+        const size_t tmp = width;
+        width = height;
+        height = tmp;
+    }
+
+    start = codec_time();
+    if (!img->codec->start(img, width, height)) {
+        open_failed(img, corrupt);
+        return NULL;
+    }
+    img->spent = codec_time() - start;
+
+    if (orient && !apply_orientation(img)) {
+        open_failed(img, corrupt);
+        return NULL;
+    }
+
+    return img;
+}
+
+struct image* image_wrap(const xrgb_t* data, size_t width, size_t height,
+                         size_t stride)
+{
+    struct image* img;
+
+    if (!width || !height || width > SIZE_MAX / sizeof(xrgb_t) ||
+        stride < width * sizeof(xrgb_t)) {
+        return NULL;
+    }
+
+    img = calloc(1, sizeof(*img));
+    if (!img) {
+        return NULL;
+    }
+    img->width = width;
+    img->height = height;
+    img->pixels = (const uint8_t*)data;
+    img->stride = stride;
 
     return img;
 }
+
+bool image_probe(const char* path, size_t* width, size_t* height)
+{
+    struct image* img = open_header(path, NULL);
+    if (!img) {
+        return false;
+    }
+
+    *width = img->width;
+    *height = img->height;
+    image_close(img);
+
+    return true;
+}
+
+void image_close(struct image* img)
+{
+    if (img) {
+        if (img->codec) {
+            img->codec->close(img);
+        }
+        pool_free(img->buffer);
+        free(img);
+    }
+}
+
+bool image_read(struct image* img, xrgb_t* row)
+{
+    if (img->row >= img->height) {
+        return false;
+    }
+
+    if (img->pixels) {
+        memcpy(row, img->pixels + img->row * img->stride,
+               img->width * sizeof(xrgb_t));
+    } else {
+        // only the time spent inside the decoder is counted
+        const uint64_t start = codec_time();
+        if (img->spent > CODEC_MAX_TIME || !img->codec->read(img, row)) {
+            return false;
+        }
+        img->spent += codec_time() - start;
+    }
+
+    ++img->row;
+
+    return true;
+}
@@ -1,24 +1,99 @@
 // SPDX-License-Identifier: MIT
-// Image loader.
+// Image loader and writer.
 // Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
 
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 typedef uint32_t xrgb_t;
 
-/** Image data. */
+/** Size of the buffer for image date, see struct image. */
+#define IMAGE_DATE_LEN 20
+
+/** Image decoder, provides pixel data row by row. */
 struct image {
-    size_t width;
-    size_t height;
-    xrgb_t* data;
+    size_t width;              ///< Image width (pixels)
+    size_t height;             ///< Image height (pixels)
+    size_t row;                ///< Index of the next row to decode
+    const struct codec* codec; ///< Format decoder, NULL for raw pixels
+    void* decoder;             ///< Decoder specific data
+    uint64_t spent;            ///< Time spent on decoding (ms)
+    bool corrupt;              ///< Decoding failed due to invalid image data
+    int orientation;           ///< EXIF orientation (1-8), 0 if not set
+    void* buffer;              ///< Oriented image, owned by the instance
+    char date[IMAGE_DATE_LEN]; ///< Date of taking the photo, empty if unknown
+    const uint8_t* pixels;     ///< Raw pixel data, NULL for encoded images
+    size_t stride;             ///< Size of the raw pixel data row in bytes
 };
 
 /**
- * Load JPEG image.
- * @param path path to the image for loading
- * @return image pixmap or NULL on errors, the caller should free the buffer
+ * Check if the file is an image of supported format, only the file signature
+ * is read.
+ * @param path path to the file
+ * @return true if the image can be decoded
+ */
+bool image_detect(const char* path);
+
+/**
+ * Open image and read its header, the format is detected by the signature.
+ * @param path path to the image file
+ * @param width,height output size hint: decoder can downscale the image while
+ *                     it is still not smaller than the specified size, 0 to
+ *                     decode the image in original size
+ * @param orient flag to rotate and flip the image according to its EXIF
+ *               orientation, such images are decoded at once and provided as
+ *               raw pixels
+ * @param corrupt optional output flag set if the image can't be opened because
+ *                the file is invalid, I/O errors, lack of memory and limits
+ *                don't set it
+ * @return image instance or NULL on errors
+ */
+struct image* image_open(const char* path, size_t width, size_t height,
+                         bool orient, bool* corrupt);
+
+/**
+ * Create image from raw pixel data, no decoding is performed.
+ * @param data pixel data, must stay valid until the image is closed
+ * @param width,height image size in pixels
+ * @param stride size of the image row in bytes
+ * @return image instance or NULL on errors
+ */
+struct image* image_wrap(const xrgb_t* data, size_t width, size_t height,
+                         size_t stride);
+
+/**
+ * Get image size without decoding, only the header is read.
+ * @param path path to the image file
+ * @param width,height output size of the image
+ * @return true if image header is valid
+ */
+bool image_probe(const char* path, size_t* width, size_t* height);
+
+/**
+ * Close image and free resources.
+ * @param img image instance
+ */
+void image_close(struct image* img);
+
+/**
+ * Decode next row of the image.
+ * @param img image instance
+ * @param row destination buffer, must have space for img->width pixels
+ * @return true if row was decoded successfully
+ */
+bool image_read(struct image* img, xrgb_t* row);
+
+/**
+ * Save image to JPEG file.
+ * @param path path to the output file
+ * @param data pixel data
+ * @param width,height image size in pixels
+ * @param stride size of the image row in bytes
+ * @param quality JPEG quality (0-100)
+ * @return true if image was saved successfully
  */
-struct image* image_load(const char* path);
+bool image_save(const char* path, const xrgb_t* data, size_t width,
+                size_t height, size_t stride, int quality);
@@ -4,7 +4,11 @@
 
 #include "imglist.h"
 
+#include "image.h"
+
 #include <dirent.h>
+#include <limits.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -16,8 +20,178 @@ struct imglist {
     char** files;   ///< Array with paths to files
     size_t size;    ///< Size of array
     size_t current; ///< Index of the current image
+    char* record;   ///< Path to the record of broken files
+};
+
+/** Broken file description. */
+struct broken {
+    char* path;      ///< Path to the file
+    long long mtime; ///< File modification time
+    long long size;  ///< File size
+    bool found;      ///< File is still present and not modified
 };
 
+/** Record of broken files. */
+struct record {
+    struct broken* files; ///< Array of broken files sorted by path
+    size_t num;           ///< Number of files in the array
+};
+
+/**
+ * Compare broken files by path.
+ * @param a,b pointers to the broken file descriptions
+ * @return comparison result, see strcmp()
+ */
+static int compare_broken(const void* a, const void* b)
+{
+    return strcmp(((const struct broken*)a)->path,
+                  ((const struct broken*)b)->path);
+}
+
+/**
+ * Load record of broken files, each line is "MTIME SIZE PATH".
+ * @param path path to the record file
+ * @param rec output record
+ */
+static void load_record(const char* path, struct record* rec)
+{
+    char line[PATH_MAX + 64];
+    size_t capacity = 0;
+    FILE* file;
+
+    file = fopen(path, "r");
+    if (!file) {
+        return;
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        struct broken entry = { 0 };
+        size_t len;
+        char* end;
+
+        entry.mtime = strtoll(line, &end, 10);
+        entry.size = strtoll(end, &end, 10);
+        if (*end != ' ') {
+            continue;
+        }
+        ++end;
+        len = strlen(end);
+        if (len && end[len - 1] == '\n') {
+            end[--len] = 0;
+        }
+        if (!len) {
+            continue;
+        }
+
+        if (rec->num == capacity) {
+            const size_t new_capacity = capacity + 64;
+            struct broken* ptr =
+                realloc(rec->files, new_capacity * sizeof(*rec->files));
+            if (!ptr) {
+                break;
+            }
+            rec->files = ptr;
+            capacity = new_capacity;
+        }
+        entry.path = malloc(len + 1);
+        if (entry.path) {
+            memcpy(entry.path, end, len + 1);
+            rec->files[rec->num++] = entry;
+        }
+    }
+
+    fclose(file);
+
+    if (rec->num) {
+        qsort(rec->files, rec->num, sizeof(*rec->files), compare_broken);
+    }
+}
+
+/**
+ * Rewrite record file without the broken files that were removed or
+ * modified, and free the record.
+ * @param path path to the record file
+ * @param rec record to save
+ */
+static void save_record(const char* path, struct record* rec)
+{
+    size_t found = 0;
+
+    for (size_t i = 0; i < rec->num; ++i) {
+        if (rec->files[i].found) {
+            ++found;
+        }
+    }
+
+    if (found != rec->num) {
+        FILE* file = fopen(path, "w");
+        if (file) {
+            for (size_t i = 0; i < rec->num; ++i) {
+                const struct broken* entry = &rec->files[i];
+                if (entry->found) {
+                    fprintf(file, "%lld %lld %s\n", entry->mtime, entry->size,
+                            entry->path);
+                }
+            }
+            fclose(file);
+        }
+    }
+
+    for (size_t i = 0; i < rec->num; ++i) {
+        free(rec->files[i].path);
+    }
+    free(rec->files);
+}
+
+/**
+ * Check if the file is in the record of broken files.
+ * @param rec record of broken files
+ * @param path path to the file
+ * @param st file status
+ * @return true if the file is broken and was not modified since
+ */
+static bool is_broken(struct record* rec, const char* path,
+                      const struct stat* st)
+{
+    struct broken key = { .path = (char*)path };
+    struct broken* entry;
+
+    if (!rec->num) {
+        return false;
+    }
+
+    entry = bsearch(&key, rec->files, rec->num, sizeof(*rec->files),
+                    compare_broken);
+    if (entry && entry->mtime == (long long)st->st_mtime &&
+        entry->size == (long long)st->st_size) {
+        entry->found = true;
+    }
+
+    return entry && entry->found;
+}
+
+/**
+ * Append file to the record of broken files.
+ * @param record path to the record file
+ * @param path path to the broken file
+ */
+static void add_broken(const char* record, const char* path)
+{
+    struct stat st;
+    FILE* file;
+
+    if (strchr(path, '\n') || stat(path, &st) != 0) {
+        return;
+    }
+
+    file = fopen(record, "a");
+    if (file) {
+        fprintf(file, "%lld %lld %s\n", (long long)st.st_mtime,
+                (long long)st.st_size, path);
+        fclose(file);
+    }
+}
+
 /**
  * Add file to the list.
  * @param list image list context
@@ -50,8 +224,9 @@ static void add_file(imglist* list, const char* path)
  * Add files from the directory to the list.
  * @param list image list context
  * @param dir full path to the directory
+ * @param rec record of broken files to skip
  */
-static void add_dir(imglist* list, const char* path)
+static void add_dir(imglist* list, const char* path, struct record* rec)
 {
     DIR* dir_handle;
     struct dirent* dir_entry;
@@ -85,8 +260,10 @@ static void add_dir(imglist* list, const char* path)
 
         if (stat(full_path, &st) == 0) {
             if (S_ISDIR(st.st_mode)) {
-                add_dir(list, full_path);
-            } else if (S_ISREG(st.st_mode)) {
+                add_dir(list, full_path, rec);
+            } else if (S_ISREG(st.st_mode) &&
+                       !is_broken(rec, full_path, &st) &&
+                       image_detect(full_path)) {
                 add_file(list, full_path);
             }
         }
@@ -112,22 +289,47 @@ static void shuffle(imglist* list)
     }
 }
 
-imglist* imglist_init(const char* dir)
+/**
+ * Set path to the record of broken files.
+ * @param list image list context
+ * @param record path to the record file, can be NULL
+ */
+static void set_record(imglist* list, const char* record)
 {
+    const size_t len = record ? strlen(record) + 1 : 0;
+
+    list->record = len ? malloc(len) : NULL;
+    if (list->record) {
+        memcpy(list->record, record, len);
+    }
+}
+
+imglist* imglist_init(const char* dir, const char* record)
+{
+    struct record rec = { 0 };
     imglist* list = calloc(1, sizeof(*list));
     if (!list) {
         fprintf(stderr, "Not enough memory\n");
         return NULL;
     }
 
-    add_dir(list, dir && *dir ? dir : ".");
+    if (record) {
+        load_record(record, &rec);
+    }
+    add_dir(list, dir && *dir ? dir : ".", &rec);
+    if (record) {
+        save_record(record, &rec);
+    }
 
     if (list->current == 0) { // list is empty
+        free(list->files);
         free(list);
         fprintf(stderr, "Image list is empty\n");
         return NULL;
     }
 
+    set_record(list, record);
+
     // at this point the current field contains number of entries
     list->size = list->current;
 
@@ -143,10 +345,49 @@ void imglist_free(imglist* list)
             free(list->files[i]);
         }
         free(list->files);
+        free(list->record);
         free(list);
     }
 }
 
+imglist* imglist_dup(const imglist* list)
+{
+    imglist* copy = calloc(1, sizeof(*copy));
+    if (!copy) {
+        fprintf(stderr, "Not enough memory\n");
+        return NULL;
+    }
+
+    for (size_t i = 0; i < list->size; ++i) {
+        if (list->files[i]) {
+            add_file(copy, list->files[i]);
+        }
+    }
+
+    if (copy->current == 0) {
+        free(copy->files);
+        free(copy);
+        return NULL;
+    }
+
+    copy->size = copy->current;
+    set_record(copy, list->record);
+
+    shuffle(copy);
+
+    return copy;
+}
+
+size_t imglist_size(const imglist* list)
+{
+    return list->size;
+}
+
+const char* imglist_get(const imglist* list, size_t index)
+{
+    return index < list->size ? list->files[index] : NULL;
+}
+
 const char* imglist_next(imglist* list)
 {
     size_t index = list->current;
@@ -162,8 +403,11 @@ const char* imglist_next(imglist* list)
     return list->files[index];
 }
 
-const char* imglist_skip(imglist* list)
+const char* imglist_skip(imglist* list, bool broken)
 {
+    if (broken && list->record && list->files[list->current]) {
+        add_broken(list->record, list->files[list->current]);
+    }
     free(list->files[list->current]);
     list->files[list->current] = NULL;
     return imglist_next(list);
@@ -4,15 +4,20 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
+
 /** Image list context. */
 typedef struct imglist imglist;
 
 /**
- * Initialize image list.
+ * Initialize image list, files of unsupported formats are skipped.
  * @param dir top directory with images
+ * @param record path to the file with list of broken images, these images are
+ *               not added to the list until they are modified, NULL to disable
  * @return image list context or NULL if list is empty
  */
-imglist* imglist_init(const char* dir);
+imglist* imglist_init(const char* dir, const char* record);
 
 /**
  * Destroy image list context.
@@ -20,6 +25,28 @@ imglist* imglist_init(const char* dir);
  */
 void imglist_free(imglist* list);
 
+/**
+ * Create a copy of the image list with its own order of files.
+ * @param list image list context to copy
+ * @return image list context or NULL on errors
+ */
+imglist* imglist_dup(const imglist* list);
+
+/**
+ * Get number of files in the list.
+ * @param list image list context
+ * @return number of files
+ */
+size_t imglist_size(const imglist* list);
+
+/**
+ * Get file by its index in the current order.
+ * @param list image list context
+ * @param index file index
+ * @return path to the file or NULL if file was removed from the list
+ */
+const char* imglist_get(const imglist* list, size_t index);
+
 /**
  * Move to the next file.
  * @param list image list context
@@ -28,8 +55,10 @@ void imglist_free(imglist* list);
 const char* imglist_next(imglist* list);
 
 /**
- * Skip current image (remove from the list).
+ * Skip current image: remove it from the list and optionally add to the record
+ * of broken images.
  * @param list image list context
+ * @param broken flag to add the image to the record of broken images
  * @return path to the next file or NULL if no more files in the list
  */
-const char* imglist_skip(imglist* list);
+const char* imglist_skip(imglist* list, bool broken);
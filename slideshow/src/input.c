@@ -0,0 +1,513 @@
+// SPDX-License-Identifier: MIT
+// User input: remote controls and control socket.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#include "input.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <linux/input.h>
+
+/** Directory with evdev devices. */
+#define EVDEV_DIR "/dev/input"
+/** Max width and height of the frame passed through the control socket. */
+#define MAX_FRAME_SIZE 16384
+/** Max number of descriptors received with a single message. */
+#define MAX_RIGHTS 4
+
+/** Key bindings. */
+struct key_binding {
+    unsigned short key;     ///< Key code
+    enum command_type type; ///< Command type
+};
+
+// clang-format off
+static const struct key_binding bindings[] = {
+    { KEY_RIGHT,        CMD_NEXT  },
+    { KEY_NEXT,         CMD_NEXT  },
+    { KEY_NEXTSONG,     CMD_NEXT  },
+    { KEY_FASTFORWARD,  CMD_NEXT  },
+    { KEY_PAGEDOWN,     CMD_NEXT  },
+    { KEY_LEFT,         CMD_PREV  },
+    { KEY_PREVIOUS,     CMD_PREV  },
+    { KEY_PREVIOUSSONG, CMD_PREV  },
+    { KEY_REWIND,       CMD_PREV  },
+    { KEY_PAGEUP,       CMD_PREV  },
+    { KEY_PLAYPAUSE,    CMD_PAUSE },
+    { KEY_PLAY,         CMD_PAUSE },
+    { KEY_PAUSE,        CMD_PAUSE },
+    { KEY_OK,           CMD_PAUSE },
+    { KEY_ENTER,        CMD_PAUSE },
+    { KEY_SPACE,        CMD_PAUSE },
+};
+// clang-format on
+
+/** Input context. */
+struct input {
+    int evdev[INPUT_MAX_FDS - 2]; ///< Evdev device handles
+    size_t num_evdev;             ///< Number of opened evdev devices
+    int notify;                   ///< Inotify handle to watch for new devices
+    int sock;                     ///< Control socket handle
+    char* sock_path;              ///< Path to the control socket
+};
+
+/**
+ * Check if evdev device has any of bound keys.
+ * @param fd device handle
+ * @return true if device is a suitable remote control
+ */
+static bool is_remote(int fd)
+{
+    uint8_t keys[KEY_MAX / 8 + 1] = { 0 };
+
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) < 0) {
+        return false;
+    }
+
+    for (size_t i = 0; i < sizeof(bindings) / sizeof(bindings[0]); ++i) {
+        const unsigned short key = bindings[i].key;
+        if (keys[key / 8] & (1 << (key % 8))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Check if evdev device is already opened.
+ * @param input pointer to the input context
+ * @param fd handle of the device to check
+ * @return true if the same device is in the list
+ */
+static bool is_opened(const input* input, int fd)
+{
+    struct stat st, opened;
+
+    if (fstat(fd, &st) < 0) {
+        return false;
+    }
+    for (size_t i = 0; i < input->num_evdev; ++i) {
+        if (fstat(input->evdev[i], &opened) == 0 &&
+            opened.st_rdev == st.st_rdev) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Open evdev device if it can be used as remote control.
+ * @param input pointer to the input context
+ * @param name name of the device file in EVDEV_DIR
+ */
+static void add_evdev(input* input, const char* name)
+{
+    char path[PATH_MAX];
+    int fd;
+
+    if (strncmp(name, "event", 5) != 0 ||
+        input->num_evdev >= sizeof(input->evdev) / sizeof(input->evdev[0])) {
+        return;
+    }
+
+    snprintf(path, sizeof(path), EVDEV_DIR "/%s", name);
+    fd = open(path, O_RDONLY | O_NONBLOCK);
+    if (fd == -1) {
+        return;
+    }
+    // the same device is reported on creation and on permissions change
+    if (!is_remote(fd) || is_opened(input, fd)) {
+        close(fd);
+        return;
+    }
+
+    input->evdev[input->num_evdev++] = fd;
+}
+
+/**
+ * Open all evdev devices that can be used as remote control and watch for
+ * new ones: remote controls can be connected or reconnected at any time.
+ * @param input pointer to the input context
+ */
+static void open_evdev(input* input)
+{
+    DIR* dir_handle;
+    struct dirent* dir_entry;
+
+    input->notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (input->notify != -1 &&
+        inotify_add_watch(input->notify, EVDEV_DIR, IN_CREATE | IN_ATTRIB) <
+            0) {
+        close(input->notify);
+        input->notify = -1;
+    }
+
+    dir_handle = opendir(EVDEV_DIR);
+    if (!dir_handle) {
+        return;
+    }
+    while ((dir_entry = readdir(dir_handle))) {
+        add_evdev(input, dir_entry->d_name);
+    }
+    closedir(dir_handle);
+}
+
+/**
+ * Open new evdev devices reported by inotify.
+ * @param input pointer to the input context
+ */
+static void read_notify(input* input)
+{
+    union {
+        struct inotify_event ev; ///< Forces alignment of the events
+        char data[4096];         ///< Buffer for the events
+    } buf;
+    ssize_t len;
+
+    while ((len = read(input->notify, buf.data, sizeof(buf.data))) > 0) {
+        ssize_t pos = 0;
+        while (pos < len) {
+            const struct inotify_event* ev =
+                (const struct inotify_event*)(buf.data + pos);
+            if (ev->len) {
+                add_evdev(input, ev->name);
+            }
+            pos += sizeof(*ev) + ev->len;
+        }
+    }
+}
+
+/**
+ * Create control socket.
+ * @param input pointer to the input context
+ * @param path path to the socket file
+ * @return true if socket created successfully
+ */
+static bool open_socket(input* input, const char* path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    const size_t len = strlen(path) + 1;
+
+    if (len > sizeof(addr.sun_path)) {
+        fprintf(stderr, "Control socket path is too long: %s\n", path);
+        return false;
+    }
+    memcpy(addr.sun_path, path, len);
+
+    input->sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (input->sock == -1) {
+        fprintf(stderr, "Unable to create control socket: [%d] %s\n", errno,
+                strerror(errno));
+        return false;
+    }
+    fcntl(input->sock, F_SETFL, O_NONBLOCK);
+
+    unlink(path);
+    if (bind(input->sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "Unable to bind control socket %s: [%d] %s\n", path,
+                errno, strerror(errno));
+        return false;
+    }
+
+    input->sock_path = malloc(len);
+    if (input->sock_path) {
+        memcpy(input->sock_path, path, len);
+    }
+
+    return true;
+}
+
+/**
+ * Read command from evdev device.
+ * @param fd device handle
+ * @param cmd output command
+ * @return false if no more commands available
+ */
+static bool read_evdev(int fd, struct command* cmd)
+{
+    struct input_event ev;
+
+    while (read(fd, &ev, sizeof(ev)) == sizeof(ev)) {
+        // key press and autorepeat
+        if (ev.type != EV_KEY || ev.value == 0) {
+            continue;
+        }
+        for (size_t i = 0; i < sizeof(bindings) / sizeof(bindings[0]); ++i) {
+            if (bindings[i].key == ev.code) {
+                if (ev.value == 2 && bindings[i].type == CMD_PAUSE) {
+                    break; // don't toggle pause on autorepeat
+                }
+                cmd->type = bindings[i].type;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Parse frame description.
+ * @param msg frame description: "WIDTH HEIGHT STRIDE FOURCC SECONDS"
+ * @param frame output frame description
+ * @return true if description is valid
+ */
+static bool parse_frame(const char* msg, struct frame* frame)
+{
+    unsigned long width, height, stride, duration;
+    char fourcc[5];
+
+    if (sscanf(msg, "%lu %lu %lu %4s %lu", &width, &height, &stride, fourcc,
+               &duration) != 5) {
+        return false;
+    }
+    // 32-bit formats compatible with the frame buffer, alpha is ignored
+    if (strcmp(fourcc, "XR24") != 0 && strcmp(fourcc, "AR24") != 0) {
+        return false;
+    }
+    // size is limited, so the row size can't overflow
+    if (!width || !height || width > MAX_FRAME_SIZE ||
+        height > MAX_FRAME_SIZE || stride < width * 4) {
+        return false;
+    }
+
+    frame->width = width;
+    frame->height = height;
+    frame->stride = stride;
+    frame->duration = duration;
+
+    return true;
+}
+
+/**
+ * Receive message from control socket.
+ * @param fd socket handle
+ * @param msg buffer for the message text
+ * @param size size of the buffer
+ * @param rfd received file descriptor, -1 if not attached, the rest of
+ *            attached descriptors are closed
+ * @return length of the message, 0 if message is truncated, or -1 if no more
+ *         messages
+ */
+static ssize_t receive(int fd, char* msg, size_t size, int* rfd)
+{
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(int) * MAX_RIGHTS)];
+    } ctl;
+    struct iovec iov = { .iov_base = msg, .iov_len = size - 1 };
+    struct msghdr mh = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = ctl.buf,
+        .msg_controllen = sizeof(ctl.buf),
+    };
+    struct cmsghdr* cmsg;
+    ssize_t len;
+
+    *rfd = -1;
+
+    len = recvmsg(fd, &mh, 0);
+    if (len < 0) {
+        return -1;
+    }
+
+    // keep the first descriptor, close all others
+    for (cmsg = CMSG_FIRSTHDR(&mh); cmsg; cmsg = CMSG_NXTHDR(&mh, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            const size_t num = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < num; ++i) {
+                int rights;
+                memcpy(&rights, CMSG_DATA(cmsg) + i * sizeof(int),
+                       sizeof(int));
+                if (*rfd == -1) {
+                    *rfd = rights;
+                } else {
+                    close(rights);
+                }
+            }
+        }
+    }
+
+    if (mh.msg_flags & (MSG_CTRUNC | MSG_TRUNC)) {
+        fprintf(stderr, "Control message is truncated\n");
+        if (*rfd != -1) {
+            close(*rfd);
+            *rfd = -1;
+        }
+        msg[0] = 0;
+        return 0;
+    }
+
+    // strip trailing new line
+    while (len > 0 && (msg[len - 1] == '\n' || msg[len - 1] == '\r')) {
+        --len;
+    }
+    msg[len] = 0;
+
+    return len;
+}
+
+/**
+ * Read command from control socket.
+ * @param fd socket handle
+ * @param cmd output command
+ * @return false if no more commands available
+ */
+static bool read_socket(int fd, struct command* cmd)
+{
+    char msg[sizeof(cmd->path) + 8];
+    int rfd;
+
+    while (receive(fd, msg, sizeof(msg), &rfd) >= 0) {
+        if (strncmp(msg, "frame ", 6) == 0 && rfd != -1 &&
+            parse_frame(msg + 6, &cmd->frame)) {
+            cmd->type = CMD_FRAME;
+            cmd->frame.fd = rfd;
+            return true;
+        }
+        if (rfd != -1) {
+            close(rfd); // descriptor is not expected
+        }
+        if (!msg[0]) {
+            continue; // empty or truncated message
+        }
+
+        if (strcmp(msg, "next") == 0) {
+            cmd->type = CMD_NEXT;
+            return true;
+        }
+        if (strcmp(msg, "prev") == 0) {
+            cmd->type = CMD_PREV;
+            return true;
+        }
+        if (strcmp(msg, "pause") == 0) {
+            cmd->type = CMD_PAUSE;
+            return true;
+        }
+        if (strncmp(msg, "goto ", 5) == 0 && msg[5]) {
+            cmd->type = CMD_GOTO;
+            strncpy(cmd->path, msg + 5, sizeof(cmd->path) - 1);
+            cmd->path[sizeof(cmd->path) - 1] = 0;
+            return true;
+        }
+
+        fprintf(stderr, "Invalid command: %s\n", msg);
+    }
+
+    return false;
+}
+
+input* input_init(const char* socket)
+{
+    input* input = calloc(1, sizeof(*input));
+    if (!input) {
+        fprintf(stderr, "Not enough memory\n");
+        return NULL;
+    }
+
+    input->notify = -1;
+    input->sock = -1;
+    if (socket && !open_socket(input, socket)) {
+        input_free(input);
+        return NULL;
+    }
+
+    open_evdev(input);
+
+    return input;
+}
+
+void input_free(input* input)
+{
+    if (input) {
+        for (size_t i = 0; i < input->num_evdev; ++i) {
+            close(input->evdev[i]);
+        }
+        if (input->notify != -1) {
+            close(input->notify);
+        }
+        if (input->sock != -1) {
+            close(input->sock);
+        }
+        if (input->sock_path) {
+            unlink(input->sock_path);
+            free(input->sock_path);
+        }
+        free(input);
+    }
+}
+
+size_t input_poll(const input* input, struct pollfd* fds)
+{
+    size_t num = 0;
+
+    for (size_t i = 0; i < input->num_evdev; ++i) {
+        fds[num].fd = input->evdev[i];
+        fds[num].events = POLLIN;
+        fds[num].revents = 0;
+        ++num;
+    }
+    if (input->notify != -1) {
+        fds[num].fd = input->notify;
+        fds[num].events = POLLIN;
+        fds[num].revents = 0;
+        ++num;
+    }
+    if (input->sock != -1) {
+        fds[num].fd = input->sock;
+        fds[num].events = POLLIN;
+        fds[num].revents = 0;
+        ++num;
+    }
+
+    return num;
+}
+
+bool input_read(input* input, int fd, struct command* cmd)
+{
+    if (fd == input->sock) {
+        return read_socket(fd, cmd);
+    }
+    if (fd == input->notify) {
+        read_notify(input);
+        return false;
+    }
+    return read_evdev(fd, cmd);
+}
+
+void input_close(input* input, int fd)
+{
+    for (size_t i = 0; i < input->num_evdev; ++i) {
+        if (input->evdev[i] == fd) {
+            // disconnected remote control, it is reopened by inotify
+            close(fd);
+            input->evdev[i] = input->evdev[--input->num_evdev];
+            return;
+        }
+    }
+
+    if (fd == input->notify) {
+        close(fd);
+        input->notify = -1;
+    } else if (fd == input->sock) {
+        fprintf(stderr, "Control socket error\n");
+        close(fd);
+        input->sock = -1;
+    }
+}
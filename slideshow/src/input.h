@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: MIT
+// User input: remote controls and control socket.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#pragma once
+
+#include <limits.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Max number of file descriptors used by input. */
+#define INPUT_MAX_FDS 8
+
+/** Command types. */
+enum command_type {
+    CMD_NEXT,  ///< Show next image
+    CMD_PREV,  ///< Show previous image
+    CMD_PAUSE, ///< Pause/resume slide show
+    CMD_GOTO,  ///< Show specified image
+    CMD_FRAME, ///< Show frame passed by the client
+};
+
+/** Frame passed through the control socket. */
+struct frame {
+    int fd;          ///< Frame data: dma-buf or memfd, owned by the receiver
+    size_t width;    ///< Frame width (pixels)
+    size_t height;   ///< Frame height (pixels)
+    size_t stride;   ///< Size of the row in bytes
+    size_t duration; ///< Display duration in seconds, 0 for default
+};
+
+/** User command. */
+struct command {
+    enum command_type type; ///< Command type
+    char path[PATH_MAX];    ///< Path to the image file (goto)
+    struct frame frame;     ///< Frame description (frame)
+};
+
+/** Input context. */
+typedef struct input input;
+
+/**
+ * Initialize input: open evdev devices and control socket.
+ * @param socket path to the control socket, NULL to disable it
+ * @return input context or NULL if error
+ */
+input* input_init(const char* socket);
+
+/**
+ * Destroy input context.
+ * @param input pointer to the input context
+ */
+void input_free(input* input);
+
+/**
+ * Fill poll descriptors for all input sources.
+ * @param input pointer to the input context
+ * @param fds array of poll descriptors to fill
+ * @return number of descriptors filled, max INPUT_MAX_FDS
+ */
+size_t input_poll(const input* input, struct pollfd* fds);
+
+/**
+ * Read next command from the input source.
+ * Control socket accepts text commands: "next", "prev", "pause",
+ * "goto PATH" and "frame WIDTH HEIGHT STRIDE FOURCC SECONDS", the last one
+ * must have a dma-buf or memfd descriptor attached (SCM_RIGHTS) that holds
+ * the frame in XR24 or AR24 format, memfd must be sealed with F_SEAL_SHRINK.
+ * @param input pointer to the input context
+ * @param fd file descriptor of the input source that has data
+ * @param cmd output command
+ * @return false if no more commands available
+ */
+bool input_read(input* input, int fd, struct command* cmd);
+
+/**
+ * Close input source that reported an error, e.g. disconnected remote
+ * control. Remote controls connected later are opened automatically.
+ * @param input pointer to the input context
+ * @param fd file descriptor of the failed input source
+ */
+void input_close(input* input, int fd);
@@ -0,0 +1,514 @@
+// SPDX-License-Identifier: MIT
+// JPEG decoder and writer.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#include "codec.h"
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// depends on stdio.h, uses FILE but doesn't include the header
+#include <jpeglib.h>
+// error codes, depends on jpeglib.h
+#include <jerror.h>
+
+/** Max size of memory used by the decoder (bytes). */
+#define MAX_MEMORY (256 * 1024 * 1024)
+
+struct jpg_error_manager {
+    struct jpeg_error_mgr mgr;
+    jmp_buf setjmp;
+};
+
+/** JPEG decoder context. */
+struct jpg_decoder {
+    struct jpeg_decompress_struct jpg; ///< libjpeg decompressor
+    struct jpg_error_manager err;      ///< Error handler
+    struct jpeg_progress_mgr progress; ///< Progress monitor
+    uint64_t spent;                    ///< Time spent on decoding (ms)
+    uint64_t resumed;                  ///< Start time of the current call
+    FILE* file;                        ///< Source file
+};
+
+/**
+ * Start measuring decoding time, the image is decoded in parts, so only the
+ * time spent inside the decoder is counted.
+ * @param dec pointer to the decoder context
+ */
+static void resume_timer(struct jpg_decoder* dec)
+{
+    dec->resumed = codec_time();
+}
+
+/**
+ * Stop measuring decoding time.
+ * @param dec pointer to the decoder context
+ */
+static void pause_timer(struct jpg_decoder* dec)
+{
+    dec->spent += codec_time() - dec->resumed;
+}
+
+/** JPEG error handler. */
+static void jpg_error_exit(j_common_ptr jpg)
+{
+    struct jpg_error_manager* err = (struct jpg_error_manager*)jpg->err;
+    char msg[JMSG_LENGTH_MAX] = { 0 };
+    (*(jpg->err->format_message))(jpg, msg);
+    longjmp(err->setjmp, 1);
+}
+
+/** JPEG progress handler: abort decoding if it takes too long. */
+static void jpg_progress(j_common_ptr jpg)
+{
+    struct jpg_decoder* dec = (struct jpg_decoder*)jpg;
+
+    if (dec->spent + codec_time() - dec->resumed > CODEC_MAX_TIME) {
+        longjmp(dec->err.setjmp, 1);
+    }
+}
+
+/**
+ * Check if decoding failed because of invalid image data.
+ * @param dec pointer to the decoder context
+ * @return false if failed on timeout, I/O error or lack of memory
+ */
+static bool is_corrupt(const struct jpg_decoder* dec)
+{
+    const int code = dec->err.mgr.msg_code;
+    return dec->spent <= CODEC_MAX_TIME && !ferror(dec->file) &&
+        code != JERR_OUT_OF_MEMORY && code != JERR_NO_BACKING_STORE;
+}
+
+/**
+ * Setup DCT scaling to decode the image in reduced size.
+ * @param jpg pointer to the decompressor
+ * @param width,height minimal size of the output image
+ */
+static void set_scale(struct jpeg_decompress_struct* jpg, size_t width,
+                      size_t height)
+{
+    unsigned int denom = 8;
+
+    if (!width || !height) {
+        return;
+    }
+
+    // get max denominator that keeps the image not smaller than the fit size
+    while (denom > 1 && jpg->image_width < denom * width &&
+           jpg->image_height < denom * height) {
+        denom /= 2;
+    }
+
+    jpg->scale_num = 1;
+    jpg->scale_denom = denom;
+}
+
+/**
+ * Initialize decoder and read JPEG header, EXIF data (APP1 markers) is kept.
+ * @param dec pointer to the decoder context
+ * @return true if header was read successfully
+ */
+static bool read_header(struct jpg_decoder* dec)
+{
+    // setup error handling
+    dec->jpg.err = jpeg_std_error(&dec->err.mgr);
+    dec->err.mgr.error_exit = jpg_error_exit;
+    if (setjmp(dec->err.setjmp)) {
+        return false;
+    }
+
+    // initialize jpeg decoder
+    jpeg_create_decompress(&dec->jpg);
+    dec->jpg.mem->max_memory_to_use = MAX_MEMORY;
+    jpeg_stdio_src(&dec->jpg, dec->file);
+    jpeg_save_markers(&dec->jpg, JPEG_APP0 + 1, 0xffff);
+    jpeg_read_header(&dec->jpg, TRUE);
+
+    return true;
+}
+
+/**
+ * Start decompression.
+ * @param dec pointer to the decoder context
+ * @param width,height output size hint
+ * @return true if decompression started successfully
+ */
+static bool start_decompress(struct jpg_decoder* dec, size_t width,
+                             size_t height)
+{
+    if (setjmp(dec->err.setjmp)) {
+        pause_timer(dec);
+        return false;
+    }
+
+    // progressive image is completely read at start
+    dec->progress.progress_monitor = jpg_progress;
+    dec->jpg.progress = &dec->progress;
+    resume_timer(dec);
+
+#ifdef JCS_EXTENSIONS
+    // libjpeg-turbo writes xrgb directly, no conversion needed
+    dec->jpg.out_color_space = JCS_EXT_BGRX;
+#else
+    dec->jpg.out_color_space = JCS_RGB;
+#endif
+    set_scale(&dec->jpg, width, height);
+    jpeg_start_decompress(&dec->jpg);
+
+    pause_timer(dec);
+
+    return true;
+}
+
+/**
+ * Get integer value from TIFF structure.
+ * @param tiff TIFF data
+ * @param size size of TIFF data
+ * @param offset offset of the value
+ * @param bytes size of the value: 2 or 4
+ * @param be flag of big endian byte order
+ * @return value or 0 if out of bounds
+ */
+static uint32_t tiff_get(const uint8_t* tiff, size_t size, size_t offset,
+                         size_t bytes, bool be)
+{
+    uint32_t val = 0;
+
+    if (offset + bytes > size) {
+        return 0;
+    }
+    for (size_t i = 0; i < bytes; ++i) {
+        const uint8_t byte = tiff[offset + (be ? i : bytes - i - 1)];
+        val = (val << 8) | byte;
+    }
+
+    return val;
+}
+
+/**
+ * Find tag in the TIFF directory.
+ * @param tiff TIFF data
+ * @param size size of TIFF data
+ * @param ifd offset of the directory
+ * @param tag tag to find
+ * @param be flag of big endian byte order
+ * @return offset of the tag entry or 0 if not found
+ */
+static size_t tiff_find(const uint8_t* tiff, size_t size, size_t ifd,
+                        uint16_t tag, bool be)
+{
+    const size_t num = tiff_get(tiff, size, ifd, 2, be);
+
+    for (size_t i = 0; i < num; ++i) {
+        const size_t entry = ifd + 2 + i * 12;
+        if (entry + 12 > size) {
+            break;
+        }
+        if (tiff_get(tiff, size, entry, 2, be) == tag) {
+            return entry;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Get date of taking the photo from EXIF data.
+ * @param exif EXIF data (APP1 marker)
+ * @param size size of EXIF data
+ * @param date output buffer for the date in format "YYYY:MM:DD HH:MM:SS"
+ * @return true if date was found
+ */
+static bool exif_date(const uint8_t* exif, size_t size, char* date)
+{
+    const uint16_t tag_exif_ifd = 0x8769;
+    const uint16_t tag_date = 0x0132;
+    const uint16_t tag_date_orig = 0x9003;
+    const size_t date_len = IMAGE_DATE_LEN - 1;
+    const uint8_t* tiff = exif + 6;
+    size_t entry;
+    size_t ifd;
+    bool be;
+
+    if (size < 6 + 8 || memcmp(exif, "Exif\0\0", 6) != 0) {
+        return false;
+    }
+    size -= 6;
+    be = tiff[0] == 'M';
+    ifd = tiff_get(tiff, size, 4, 4, be);
+
+    // original date from EXIF directory, modification date from IFD0
+    entry = tiff_find(tiff, size, ifd, tag_exif_ifd, be);
+    if (entry) {
+        const size_t exif_ifd = tiff_get(tiff, size, entry + 8, 4, be);
+        entry = tiff_find(tiff, size, exif_ifd, tag_date_orig, be);
+    }
+    if (!entry) {
+        entry = tiff_find(tiff, size, ifd, tag_date, be);
+    }
+    if (!entry || tiff_get(tiff, size, entry + 4, 4, be) < date_len) {
+        return false;
+    }
+
+    entry = tiff_get(tiff, size, entry + 8, 4, be);
+    if (entry + date_len > size || tiff[entry] < '1' || tiff[entry] > '9') {
+        return false; // invalid or empty date ("0000:00:00" or spaces)
+    }
+    memcpy(date, tiff + entry, date_len);
+    date[date_len] = 0;
+
+    return true;
+}
+
+/**
+ * Get image orientation from EXIF data.
+ * @param exif EXIF data (APP1 marker)
+ * @param size size of EXIF data
+ * @return orientation (1-8) or 0 if not found
+ */
+static int exif_orientation(const uint8_t* exif, size_t size)
+{
+    const uint16_t tag_orientation = 0x0112;
+    const uint8_t* tiff = exif + 6;
+    size_t entry;
+    uint32_t val;
+    bool be;
+
+    if (size < 6 + 8 || memcmp(exif, "Exif\0\0", 6) != 0) {
+        return 0;
+    }
+    size -= 6;
+    be = tiff[0] == 'M';
+
+    entry = tiff_find(tiff, size, tiff_get(tiff, size, 4, 4, be),
+                      tag_orientation, be);
+    if (!entry) {
+        return 0;
+    }
+    val = tiff_get(tiff, size, entry + 8, 2, be);
+
+    return val >= 1 && val <= 8 ? val : 0;
+}
+
+/**
+ * Check JPEG signature.
+ * @param sig file signature
+ * @param size size of the signature
+ * @return true if file is JPEG
+ */
+static bool jpg_match(const uint8_t* sig, size_t size)
+{
+    return size >= 3 && sig[0] == 0xff && sig[1] == 0xd8 && sig[2] == 0xff;
+}
+
+/**
+ * Read JPEG header.
+ * @param img image instance
+ * @param file source file
+ * @return true if header was read successfully
+ */
+static bool jpg_open(struct image* img, FILE* file)
+{
+    struct jpg_decoder* dec = img->decoder;
+
+    dec->file = file;
+    if (!read_header(dec)) {
+        img->corrupt = is_corrupt(dec);
+        return false;
+    }
+
+    img->width = dec->jpg.image_width;
+    img->height = dec->jpg.image_height;
+
+    // EXIF is read here to not parse the header again for the caption
+    for (jpeg_saved_marker_ptr mk = dec->jpg.marker_list; mk; mk = mk->next) {
+        if (!img->orientation) {
+            img->orientation = exif_orientation(mk->data, mk->data_length);
+        }
+        if (!img->date[0]) {
+            exif_date(mk->data, mk->data_length, img->date);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Start decoding JPEG image.
+ * @param img image instance
+ * @param width,height output size hint
+ * @return true if decoding started successfully
+ */
+static bool jpg_start(struct image* img, size_t width, size_t height)
+{
+    struct jpg_decoder* dec = img->decoder;
+
+    if (!start_decompress(dec, width, height)) {
+        img->corrupt = is_corrupt(dec);
+        return false;
+    }
+
+    img->width = dec->jpg.output_width;
+    img->height = dec->jpg.output_height;
+
+    return true;
+}
+
+/**
+ * Free JPEG decoder.
+ * @param img image instance
+ */
+static void jpg_close(struct image* img)
+{
+    struct jpg_decoder* dec = img->decoder;
+
+    jpeg_destroy_decompress(&dec->jpg);
+    if (dec->file) {
+        fclose(dec->file);
+    }
+}
+
+/**
+ * Decode next row of JPEG image.
+ * @param img image instance
+ * @param row destination buffer
+ * @return true if row was decoded successfully
+ */
+static bool jpg_read(struct image* img, xrgb_t* row)
+{
+    struct jpg_decoder* dec = img->decoder;
+    uint8_t* line = (uint8_t*)row;
+
+    if (setjmp(dec->err.setjmp)) {
+        pause_timer(dec);
+        img->corrupt = is_corrupt(dec);
+        return false;
+    }
+
+    resume_timer(dec);
+    jpeg_read_scanlines(&dec->jpg, &line, 1);
+
+#ifndef JCS_EXTENSIONS
+    // convert to 32-bit xrgb
+    if (dec->jpg.out_color_components == 1) {
+        for (int x = img->width - 1; x >= 0; --x) {
+            const xrgb_t c = *(line + x);
+            row[x] = ((xrgb_t)0xff << 24) | (c << 16) | (c << 8) | c;
+        }
+    } else if (dec->jpg.out_color_components == 3) {
+        for (int x = img->width - 1; x >= 0; --x) {
+            const uint8_t* src = line + x * 3;
+            const xrgb_t r = src[0];
+            const xrgb_t g = src[1];
+            const xrgb_t b = src[2];
+            row[x] = ((xrgb_t)0xff << 24) | (r << 16) | (g << 8) | b;
+        }
+    }
+#endif
+
+    if (img->row + 1 == img->height) {
+        jpeg_finish_decompress(&dec->jpg);
+    }
+
+    pause_timer(dec);
+
+    return true;
+}
+
+const struct codec codec_jpeg = {
+    .context = sizeof(struct jpg_decoder),
+    .match = jpg_match,
+    .open = jpg_open,
+    .start = jpg_start,
+    .read = jpg_read,
+    .close = jpg_close,
+};
+
+/**
+ * Compress image.
+ * @param jpg pointer to the compressor
+ * @param err pointer to the error handler
+ * @param data pixel data
+ * @param stride size of the image row in bytes
+ * @param quality JPEG quality (0-100)
+ * @return true if image was compressed successfully
+ */
+static bool compress(struct jpeg_compress_struct* jpg,
+                     struct jpg_error_manager* err, const xrgb_t* data,
+                     size_t stride, int quality)
+{
+#ifndef JCS_EXTENSIONS
+    uint8_t* rgb;
+#endif
+
+    if (setjmp(err->setjmp)) {
+        return false;
+    }
+
+#ifdef JCS_EXTENSIONS
+    jpg->in_color_space = JCS_EXT_BGRX;
+    jpg->input_components = 4;
+#else
+    jpg->in_color_space = JCS_RGB;
+    jpg->input_components = 3;
+    rgb = (uint8_t*)jpg->mem->alloc_small((j_common_ptr)jpg, JPOOL_PERMANENT,
+                                          jpg->image_width * 3);
+#endif
+    jpeg_set_defaults(jpg);
+    jpeg_set_quality(jpg, quality, TRUE);
+    jpeg_start_compress(jpg, TRUE);
+
+    while (jpg->next_scanline < jpg->image_height) {
+        const xrgb_t* row =
+            (const xrgb_t*)((const uint8_t*)data + jpg->next_scanline * stride);
+#ifdef JCS_EXTENSIONS
+        JSAMPROW line = (JSAMPROW)row;
+#else
+        JSAMPROW line = rgb;
+        // convert from 32-bit xrgb
+        for (size_t x = 0; x < jpg->image_width; ++x) {
+            rgb[x * 3 + 0] = row[x] >> 16;
+            rgb[x * 3 + 1] = row[x] >> 8;
+            rgb[x * 3 + 2] = row[x];
+        }
+#endif
+        jpeg_write_scanlines(jpg, &line, 1);
+    }
+
+    jpeg_finish_compress(jpg);
+
+    return true;
+}
+
+bool image_save(const char* path, const xrgb_t* data, size_t width,
+                size_t height, size_t stride, int quality)
+{
+    struct jpeg_compress_struct jpg;
+    struct jpg_error_manager err;
+    FILE* file;
+    bool rc;
+
+    file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+
+    jpg.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = jpg_error_exit;
+    jpeg_create_compress(&jpg);
+    jpeg_stdio_dest(&jpg, file);
+    jpg.image_width = width;
+    jpg.image_height = height;
+
+    rc = compress(&jpg, &err, data, stride, quality);
+
+    jpeg_destroy_compress(&jpg);
+    if (fclose(file) != 0) {
+        rc = false;
+    }
+
+    return rc;
+}
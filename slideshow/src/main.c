@@ -2,16 +2,23 @@
 // Program entry point.
 // Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
 
+#include "config.h"
 #include "display.h"
+#include "image.h"
 #include "imglist.h"
+#include "pool.h"
 #include "sshow.h"
 
 #include <getopt.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+/** Number of images used to detect the dominant resolution. */
+#define AUTO_MODE_SAMPLES 32
+
 /** Command line arguments. */
 struct cmdarg {
     const char short_opt; ///< Short option character
@@ -22,8 +29,15 @@ struct cmdarg {
 
 // clang-format off
 static const struct cmdarg arguments[] = {
-    { 'v', "version",    NULL,    "print version info and exit" },
-    { 'h', "help",       NULL,    "print this help and exit" },
+    { 'm', "mode",        "MODE",  "display mode: WxH[@Hz] or auto" },
+    { 'i', "independent", NULL,    "show independent slides on each output" },
+    { 'c', "control",     "PATH",  "create control socket" },
+    { 'b', "background",  "MODE",  "letterbox fill: black or blur" },
+    { 'f', "font",        "PATH",  "show caption using the font file" },
+    { 'z', "font-size",   "NUM",   "caption font size" },
+    { 'k', "kenburns",    NULL,    "animate slides with slow pan and zoom" },
+    { 'v', "version",     NULL,    "print version info and exit" },
+    { 'h', "help",        NULL,    "print this help and exit" },
 };
 // clang-format on
 
@@ -41,7 +55,7 @@ static void print_help(void)
         } else {
             strncpy(lopt, arg->long_opt, sizeof(lopt) - 1);
         }
-        printf("  -%c, --%-14s %s\n", arg->short_opt, lopt, arg->help);
+        printf("  -%c, --%-16s %s\n", arg->short_opt, lopt, arg->help);
     }
 }
 
@@ -54,17 +68,100 @@ static void print_version(void)
     puts("https://github.com/artemsen/???");
 }
 
+/**
+ * Parse display mode.
+ * @param str mode description in format WxH[@Hz]
+ * @param mode output mode
+ * @return true if mode is valid
+ */
+static bool parse_mode(const char* str, struct display_mode* mode)
+{
+    char* end;
+
+    mode->width = strtoul(str, &end, 10);
+    if (!mode->width || *end != 'x') {
+        return false;
+    }
+    mode->height = strtoul(end + 1, &end, 10);
+    if (!mode->height) {
+        return false;
+    }
+    if (*end == '@') {
+        mode->rate = strtoul(end + 1, &end, 10);
+    }
+
+    return *end == 0;
+}
+
+/**
+ * Detect resolutions of images: the list is already shuffled, so headers of
+ * the first files are a random sample of the whole list. Sizes are ranked by
+ * the number of images, an output uses the first size it supports.
+ * @param list image list context
+ * @param sizes output array of modes, must have space for
+ *              AUTO_MODE_SAMPLES + 1 entries, the last one is the default mode
+ * @return number of modes in the array
+ */
+static size_t detect_modes(const imglist* list, struct display_mode* sizes)
+{
+    size_t counts[AUTO_MODE_SAMPLES] = { 0 };
+    size_t num_sizes = 0;
+
+    for (size_t i = 0; i < imglist_size(list) && i < AUTO_MODE_SAMPLES; ++i) {
+        const char* path = imglist_get(list, i);
+        size_t width, height, j;
+
+        if (!path || !image_probe(path, &width, &height)) {
+            continue;
+        }
+        for (j = 0; j < num_sizes; ++j) {
+            if (sizes[j].width == width && sizes[j].height == height) {
+                break;
+            }
+        }
+        if (j == num_sizes) {
+            sizes[j].width = width;
+            sizes[j].height = height;
+            sizes[j].rate = 0;
+            ++num_sizes;
+        }
+        ++counts[j];
+    }
+
+    // sort by number of images, the first seen size wins on ties
+    for (size_t i = 1; i < num_sizes; ++i) {
+        const struct display_mode size = sizes[i];
+        const size_t count = counts[i];
+        size_t j = i;
+        for (; j > 0 && counts[j - 1] < count; --j) {
+            sizes[j] = sizes[j - 1];
+            counts[j] = counts[j - 1];
+        }
+        sizes[j] = size;
+        counts[j] = count;
+    }
+
+    // fall back to the default mode silently
+    sizes[num_sizes].width = 0;
+    sizes[num_sizes].height = 0;
+    sizes[num_sizes].rate = 0;
+
+    return num_sizes + 1;
+}
+
 /**
  * Parse command line arguments.
  * @param argc number of arguments to parse
  * @param argv arguments array
+ * @param cfg configuration to fill
  * @return index of the first non option argument
  */
-static int parse_cmdargs(int argc, char* argv[] /* , struct config* cfg */)
+static int parse_cmdargs(int argc, char* argv[], struct config* cfg)
 {
     struct option options[1 + sizeof(arguments) / sizeof(arguments[0])];
     char short_opts[sizeof(arguments) / sizeof(arguments[0]) * 2];
     char* short_opts_ptr = short_opts;
+    char* end;
     int opt;
 
     // compose array of option structs
@@ -88,6 +185,43 @@ static int parse_cmdargs(int argc, char* argv[] /* , struct config* cfg */)
     // parse arguments
     while ((opt = getopt_long(argc, argv, short_opts, options, NULL)) != -1) {
         switch (opt) {
+            case 'm':
+                if (strcmp(optarg, "auto") == 0) {
+                    cfg->mode_auto = true;
+                } else if (!parse_mode(optarg, &cfg->mode)) {
+                    fprintf(stderr, "Invalid display mode: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'i':
+                cfg->independent = true;
+                break;
+            case 'c':
+                cfg->control = optarg;
+                break;
+            case 'b':
+                if (strcmp(optarg, "black") == 0) {
+                    cfg->bkg = BKG_BLACK;
+                } else if (strcmp(optarg, "blur") == 0) {
+                    cfg->bkg = BKG_BLUR;
+                } else {
+                    fprintf(stderr, "Invalid background mode: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'f':
+                cfg->font = optarg;
+                break;
+            case 'z':
+                cfg->font_size = strtoul(optarg, &end, 10);
+                if (!cfg->font_size || *end) {
+                    fprintf(stderr, "Invalid font size: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'k':
+                cfg->kenburns = true;
+                break;
             case 'v':
                 print_version();
                 exit(EXIT_SUCCESS);
@@ -113,29 +247,43 @@ int main(int argc, char* argv[])
     imglist* list = NULL;
     display* display = NULL;
     struct timespec ts;
-    // struct config* cfg;
+    struct config cfg = { 0 };
+    struct display_mode modes[AUTO_MODE_SAMPLES + 1];
+    size_t num_modes = 0;
+    const char* cache = getenv("XDG_CACHE_HOME");
+    char record[PATH_MAX];
     int argn;
 
-    argn = parse_cmdargs(argc, argv /* , cfg */);
+    argn = parse_cmdargs(argc, argv, &cfg);
 
     // init rng
     clock_gettime(CLOCK_MONOTONIC, &ts);
     srand(ts.tv_nsec);
 
-    list = imglist_init(argn >= argc ? NULL : argv[argn]);
+    snprintf(record, sizeof(record), "%s/slideshow-broken.list",
+             cache ? cache : CACHE_DIR);
+    list = imglist_init(argn >= argc ? NULL : argv[argn], record);
     if (!list) {
         goto done;
     }
 
-    display = display_init();
+    if (cfg.mode_auto) {
+        num_modes = detect_modes(list, modes);
+    } else if (cfg.mode.width) {
+        modes[0] = cfg.mode;
+        num_modes = 1;
+    }
+
+    display = display_init(modes, num_modes);
     if (!display) {
         goto done;
     }
 
-    rc = slide_show(list, display) ? EXIT_SUCCESS : EXIT_FAILURE;
+    rc = slide_show(list, display, &cfg) ? EXIT_SUCCESS : EXIT_FAILURE;
 
 done:
     display_free(display);
     imglist_free(list);
+    pool_purge();
     return rc;
 }
@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: MIT
+// Image pyramid for animated pan and zoom.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#include "mipmap.h"
+
+#include "pool.h"
+#include "scale.h"
+
+#include <stdlib.h>
+
+/** Fixed point precision of sampling coordinates. */
+#define COORD_BITS 16
+
+/** Image pyramid. */
+struct mipmap {
+    struct buffer levels[MIPMAP_LEVELS]; ///< Levels, the first one is base
+    size_t num;                          ///< Number of levels
+    uint8_t* data;                       ///< Memory of all levels
+};
+
+/**
+ * Average of four pixels.
+ * @param a,b,c,d pixels to average
+ * @return averaged pixel
+ */
+static inline xrgb_t average(xrgb_t a, xrgb_t b, xrgb_t c, xrgb_t d)
+{
+    const uint32_t rb = (a & 0xff00ff) + (b & 0xff00ff) + (c & 0xff00ff) +
+        (d & 0xff00ff) + 0x020002;
+    const uint32_t g = (a & 0x00ff00) + (b & 0x00ff00) + (c & 0x00ff00) +
+        (d & 0x00ff00) + 0x000200;
+    return ((xrgb_t)0xff << 24) | ((rb >> 2) & 0xff00ff) |
+        ((g >> 2) & 0x00ff00);
+}
+
+/**
+ * Downscale level by 2 with box filter.
+ * @param src source level
+ * @param dst destination level
+ */
+static void downscale(const struct buffer* src, struct buffer* dst)
+{
+    for (size_t y = 0; y < dst->height; ++y) {
+        const xrgb_t* s0 = (const xrgb_t*)(src->data + y * 2 * src->stride);
+        const xrgb_t* s1 = (const xrgb_t*)((const uint8_t*)s0 + src->stride);
+        xrgb_t* d = (xrgb_t*)(dst->data + y * dst->stride);
+        for (size_t x = 0; x < dst->width; ++x) {
+            d[x] = average(s0[x * 2], s0[x * 2 + 1], s1[x * 2], s1[x * 2 + 1]);
+        }
+    }
+}
+
+/**
+ * Get fixed point sampling coordinate clamped to the level size.
+ * @param pos coordinate
+ * @param max max valid coordinate
+ * @return fixed point coordinate
+ */
+static inline uint32_t clamp_coord(int32_t pos, int32_t max)
+{
+    return pos < 0 ? 0 : (pos > max ? max : pos);
+}
+
+mipmap* mipmap_create(size_t width, size_t height, size_t min_width,
+                      size_t min_height)
+{
+    mipmap* mm;
+    size_t size = 0;
+
+    mm = calloc(1, sizeof(*mm));
+    if (!mm) {
+        return NULL;
+    }
+
+    // each next level is half of the previous one while it's large enough
+    for (size_t i = 0; i < MIPMAP_LEVELS; ++i) {
+        struct buffer* level = &mm->levels[i];
+        if (i) {
+            const struct buffer* prev = &mm->levels[i - 1];
+            if (prev->width / 2 < min_width || prev->height / 2 < min_height ||
+                prev->width < 2 || prev->height < 2) {
+                break;
+            }
+            level->width = prev->width / 2;
+            level->height = prev->height / 2;
+        } else {
+            level->width = width;
+            level->height = height;
+        }
+        level->stride = level->width * sizeof(xrgb_t);
+        level->size = level->stride * level->height;
+        // uninitialized memory
+        level->drawn = (struct rect) { 0, 0, level->width, level->height };
+        size += level->size;
+        ++mm->num;
+    }
+
+    mm->data = pool_alloc(size);
+    if (!mm->data) {
+        free(mm);
+        return NULL;
+    }
+    size = 0;
+    for (size_t i = 0; i < mm->num; ++i) {
+        mm->levels[i].data = mm->data + size;
+        size += mm->levels[i].size;
+    }
+
+    return mm;
+}
+
+void mipmap_free(mipmap* mm)
+{
+    if (mm) {
+        pool_free(mm->data);
+        free(mm);
+    }
+}
+
+struct buffer* mipmap_base(mipmap* mm)
+{
+    return &mm->levels[0];
+}
+
+void mipmap_build(mipmap* mm)
+{
+    for (size_t i = 1; i < mm->num; ++i) {
+        downscale(&mm->levels[i - 1], &mm->levels[i]);
+    }
+}
+
+void mipmap_draw(const mipmap* mm, struct buffer* fb, float x, float y,
+                 float scale)
+{
+    const struct buffer* level;
+    size_t index = 0;
+    float factor = 1.0f;
+    int32_t u, v, du, dv, umax, vmax;
+    uint32_t* cols;
+    xrgb_t* row;
+    size_t first, last;
+
+    // the smallest level that is not upscaled
+    while (index + 1 < mm->num && scale >= factor * 2) {
+        factor *= 2;
+        ++index;
+    }
+    level = &mm->levels[index];
+
+    // pixel centers in level coordinates
+    scale /= factor;
+    du = dv = scale * (1 << COORD_BITS);
+    u = ((x / factor) + scale / 2 - 0.5f) * (1 << COORD_BITS);
+    v = ((y / factor) + scale / 2 - 0.5f) * (1 << COORD_BITS);
+    umax = (int32_t)(level->width - 1) << COORD_BITS;
+    vmax = (int32_t)(level->height - 1) << COORD_BITS;
+
+    // horizontal sampling positions are the same for all rows
+    cols = pool_alloc(fb->width * sizeof(*cols));
+    row = pool_alloc((level->width + 1) * sizeof(*row));
+    if (!cols || !row) {
+        pool_free(cols);
+        pool_free(row);
+        return;
+    }
+    for (size_t dx = 0; dx < fb->width; ++dx, u += du) {
+        cols[dx] = clamp_coord(u, umax);
+    }
+    first = cols[0] >> COORD_BITS;
+    last = (cols[fb->width - 1] >> COORD_BITS) + 1;
+    if (last >= level->width) {
+        last = level->width - 1;
+    }
+
+    for (size_t dy = 0; dy < fb->height; ++dy, v += dv) {
+        const uint32_t sv = clamp_coord(v, vmax);
+        const size_t sy = sv >> COORD_BITS;
+        const uint32_t fy =
+            (sv >> (COORD_BITS - SCALE_FRAC_BITS)) & SCALE_FRAC_MASK;
+        const xrgb_t* r0 = (const xrgb_t*)(level->data + sy * level->stride);
+        const xrgb_t* r1 = sy + 1 < level->height
+            ? (const xrgb_t*)((const uint8_t*)r0 + level->stride)
+            : r0;
+        xrgb_t* dst = (xrgb_t*)(fb->data + dy * fb->stride);
+
+        // vertical pass over the visible part of the source rows, the extra
+        // pixel at the end makes the right neighbor always available
+        for (size_t sx = first; sx <= last; ++sx) {
+            row[sx] = scale_blend(r0[sx], r1[sx], fy);
+        }
+        row[last + 1] = row[last];
+
+        // horizontal pass
+        for (size_t dx = 0; dx < fb->width; ++dx) {
+            const uint32_t su = cols[dx];
+            const size_t sx = su >> COORD_BITS;
+            const uint32_t fx =
+                (su >> (COORD_BITS - SCALE_FRAC_BITS)) & SCALE_FRAC_MASK;
+            dst[dx] = scale_blend(row[sx], row[sx + 1], fx);
+        }
+    }
+
+    pool_free(cols);
+    pool_free(row);
+
+    fb->drawn = (struct rect) { 0, 0, fb->width, fb->height };
+}
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: MIT
+// Image pyramid for animated pan and zoom.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#pragma once
+
+#include "display.h"
+
+/** Max number of pyramid levels. */
+#define MIPMAP_LEVELS 8
+
+/** Image pyramid: the base level and its copies downscaled by 2, 4, etc. */
+typedef struct mipmap mipmap;
+
+/**
+ * Create image pyramid.
+ * @param width,height size of the base level
+ * @param min_width,min_height the smallest level is not less than this size
+ * @return pyramid or NULL if not enough memory
+ */
+mipmap* mipmap_create(size_t width, size_t height, size_t min_width,
+                      size_t min_height);
+
+/**
+ * Destroy image pyramid.
+ * @param mm image pyramid, can be NULL
+ */
+void mipmap_free(mipmap* mm);
+
+/**
+ * Get the base level to draw the image on.
+ * @param mm image pyramid
+ * @return pointer to the base level buffer
+ */
+struct buffer* mipmap_base(mipmap* mm);
+
+/**
+ * Build downscaled levels from the base one.
+ * @param mm image pyramid
+ */
+void mipmap_build(mipmap* mm);
+
+/**
+ * Draw part of the image on the frame buffer, the level closest to the
+ * requested scale is sampled with bilinear filter, so the cost depends only
+ * on the frame buffer size.
+ * @param mm image pyramid
+ * @param fb destination frame buffer
+ * @param x,y top left corner of the visible part on the base level
+ * @param scale number of base level pixels per frame buffer pixel
+ */
+void mipmap_draw(const mipmap* mm, struct buffer* fb, float x, float y,
+                 float scale);
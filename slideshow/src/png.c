@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: MIT
+// PNG decoder.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#include "codec.h"
+#include "pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <png.h>
+
+/** PNG decoder context. */
+struct png_decoder {
+    png_structp png;   ///< libpng decoder
+    png_infop info;    ///< Image info
+    FILE* file;        ///< Source file
+    uint8_t* data;     ///< Whole decoded image for interlaced PNG
+    uint64_t deadline; ///< Time limit of decoding the whole image
+};
+
+/** PNG error handler. */
+static void png_dec_error(png_structp png, png_const_charp msg)
+{
+    struct image* img = png_get_error_ptr(png);
+    const struct png_decoder* dec = img->decoder;
+    const bool timeout = dec->deadline && codec_time() > dec->deadline;
+
+    // libpng reports lack of memory only by the message text
+    img->corrupt = !timeout && !ferror(dec->file) && !strstr(msg, "memory");
+
+    png_longjmp(png, 1);
+}
+
+/** PNG warning handler. */
+static void png_dec_warning(png_structp png, png_const_charp msg)
+{
+    (void)png;
+    (void)msg;
+}
+
+/** PNG row callback: abort decoding if it takes too long. */
+static void png_dec_row(png_structp png, png_uint_32 row, int pass)
+{
+    const struct image* img = png_get_error_ptr(png);
+    const struct png_decoder* dec = img->decoder;
+
+    (void)row;
+    (void)pass;
+
+    if (codec_time() > dec->deadline) {
+        png_error(png, "Decoding takes too long");
+    }
+}
+
+/**
+ * Check PNG signature.
+ * @param sig file signature
+ * @param size size of the signature
+ * @return true if file is PNG
+ */
+static bool png_dec_match(const uint8_t* sig, size_t size)
+{
+    return size >= 8 && png_sig_cmp(sig, 0, 8) == 0;
+}
+
+/**
+ * Read PNG header.
+ * @param img image instance
+ * @param file source file
+ * @return true if header was read successfully
+ */
+static bool png_dec_open(struct image* img, FILE* file)
+{
+    struct png_decoder* dec = img->decoder;
+
+    dec->file = file;
+    dec->png = png_create_read_struct(PNG_LIBPNG_VER_STRING, img,
+                                      png_dec_error, png_dec_warning);
+    if (!dec->png) {
+        return false;
+    }
+    dec->info = png_create_info_struct(dec->png);
+    if (!dec->info) {
+        return false;
+    }
+
+    if (setjmp(png_jmpbuf(dec->png))) {
+        return false;
+    }
+
+    png_init_io(dec->png, file);
+    png_read_info(dec->png, dec->info);
+
+    img->width = png_get_image_width(dec->png, dec->info);
+    img->height = png_get_image_height(dec->png, dec->info);
+
+    return true;
+}
+
+/**
+ * Decode the whole interlaced image at once, it can't be read row by row.
+ * @param img image instance
+ * @return true if image was decoded successfully
+ */
+static bool png_dec_all(struct image* img)
+{
+    struct png_decoder* dec = img->decoder;
+    const size_t stride = img->width * sizeof(xrgb_t);
+    png_bytep* rows;
+
+    if (img->height > CODEC_MAX_BUFFER / stride) {
+        return false;
+    }
+
+    dec->data = pool_alloc(img->height * stride);
+    rows = malloc(img->height * sizeof(*rows));
+    if (!dec->data || !rows) {
+        free(rows);
+        return false;
+    }
+    for (size_t y = 0; y < img->height; ++y) {
+        rows[y] = dec->data + y * stride;
+    }
+
+    if (setjmp(png_jmpbuf(dec->png))) {
+        free(rows);
+        return false;
+    }
+
+    dec->deadline = codec_time() + CODEC_MAX_TIME;
+    png_set_read_status_fn(dec->png, png_dec_row);
+    png_read_image(dec->png, rows);
+    png_read_end(dec->png, NULL);
+    free(rows);
+
+    // provide decoded image as raw pixels
+    img->pixels = dec->data;
+    img->stride = stride;
+
+    return true;
+}
+
+/**
+ * Start decoding PNG image, the size hint is ignored as PNG can't be
+ * downscaled by the decoder.
+ * @param img image instance
+ * @param width,height output size hint
+ * @return true if decoding started successfully
+ */
+static bool png_dec_start(struct image* img, size_t width, size_t height)
+{
+    struct png_decoder* dec = img->decoder;
+    int passes;
+
+    (void)width;
+    (void)height;
+
+    if (setjmp(png_jmpbuf(dec->png))) {
+        return false;
+    }
+
+    // convert any format to 32-bit xrgb
+    png_set_expand(dec->png);
+    png_set_strip_16(dec->png);
+    png_set_gray_to_rgb(dec->png);
+    png_set_bgr(dec->png);
+    if ((png_get_color_type(dec->png, dec->info) & PNG_COLOR_MASK_ALPHA) ||
+        png_get_valid(dec->png, dec->info, PNG_INFO_tRNS)) {
+        // transparent pixels on black background
+        png_color_16 black = { 0 };
+        png_set_background(dec->png, &black, PNG_BACKGROUND_GAMMA_SCREEN, 0,
+                           1.0);
+    }
+    png_set_filler(dec->png, 0xff, PNG_FILLER_AFTER);
+    passes = png_set_interlace_handling(dec->png);
+    png_read_update_info(dec->png, dec->info);
+
+    return passes == 1 || png_dec_all(img);
+}
+
+/**
+ * Decode next row of PNG image.
+ * @param img image instance
+ * @param row destination buffer
+ * @return true if row was decoded successfully
+ */
+static bool png_dec_read(struct image* img, xrgb_t* row)
+{
+    struct png_decoder* dec = img->decoder;
+
+    if (setjmp(png_jmpbuf(dec->png))) {
+        return false;
+    }
+
+    png_read_row(dec->png, (png_bytep)row, NULL);
+
+    if (img->row + 1 == img->height) {
+        png_read_end(dec->png, NULL);
+    }
+
+    return true;
+}
+
+/**
+ * Free PNG decoder.
+ * @param img image instance
+ */
+static void png_dec_close(struct image* img)
+{
+    struct png_decoder* dec = img->decoder;
+
+    png_destroy_read_struct(&dec->png, &dec->info, NULL);
+    pool_free(dec->data);
+    if (dec->file) {
+        fclose(dec->file);
+    }
+}
+
+const struct codec codec_png = {
+    .context = sizeof(struct png_decoder),
+    .match = png_dec_match,
+    .open = png_dec_open,
+    .start = png_dec_start,
+    .read = png_dec_read,
+    .close = png_dec_close,
+};
@@ -0,0 +1,248 @@
+// SPDX-License-Identifier: MIT
+// Pool of reusable memory buffers.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+// Linux specific mmap flags: MAP_ANONYMOUS, MADV_HUGEPAGE, MADV_POPULATE_WRITE
+#define _DEFAULT_SOURCE
+
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/** Size of the block header, keeps the data aligned for vector operations. */
+#define HEADER_SIZE 64
+/** Min block size (log2): smaller buffers are allocated from the heap. */
+#define MIN_SHIFT 16
+/** Max block size (log2). */
+#define MAX_SHIFT (sizeof(size_t) * 8 - 2)
+/** Number of size classes per power of two, limits the unused tail. */
+#define CLASS_STEPS 4
+/** Total number of size classes. */
+#define NUM_CLASSES ((MAX_SHIFT - MIN_SHIFT) * CLASS_STEPS)
+/** Max number of released blocks kept in the pool per size class. */
+#define MAX_FREE 8
+/** Size and alignment of transparent huge pages. */
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/** Memory block header. */
+struct block {
+    size_t cls;         ///< Size class + 1, 0 for heap allocated blocks
+    struct block* next; ///< Next free block in the pool
+};
+
+/** Released blocks. */
+struct pool {
+    struct block* free[NUM_CLASSES]; ///< Lists of free blocks per class
+    size_t count[NUM_CLASSES];       ///< Number of free blocks per class
+    pthread_mutex_t lock;            ///< Pool lock
+};
+
+static struct pool pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/**
+ * Get size class for the block: each power of two range is split into
+ * CLASS_STEPS equal steps.
+ * @param size block size including header
+ * @return size class
+ */
+static size_t size_class(size_t size)
+{
+    size_t shift = MIN_SHIFT;
+    size_t step;
+
+    while (((size_t)2 << shift) < size) {
+        ++shift;
+    }
+    step = ((size_t)1 << shift) / CLASS_STEPS;
+
+    return (shift - MIN_SHIFT) * CLASS_STEPS +
+        (size - ((size_t)1 << shift) + step - 1) / step - 1;
+}
+
+/**
+ * Get block size of the class.
+ * @param cls size class
+ * @return block size in bytes
+ */
+static size_t class_size(size_t cls)
+{
+    const size_t base = (size_t)1 << (MIN_SHIFT + cls / CLASS_STEPS);
+    return base + (base / CLASS_STEPS) * (cls % CLASS_STEPS + 1);
+}
+
+/**
+ * Map memory aligned to the huge page boundary: the region is over-mapped
+ * and trimmed, so the kernel can back it with huge pages.
+ * @param size size of the region
+ * @return pointer to the region or NULL if not enough memory
+ */
+static uint8_t* map_aligned(size_t size)
+{
+    const size_t total = size + HUGE_PAGE_SIZE;
+    uint8_t* start;
+    uint8_t* ptr;
+
+    start = mmap(NULL, total, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (start == MAP_FAILED) {
+        return NULL;
+    }
+
+    ptr = (uint8_t*)(((uintptr_t)start + HUGE_PAGE_SIZE - 1) &
+                     ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+    if (ptr != start) {
+        munmap(start, ptr - start);
+    }
+    if (ptr + size != start + total) {
+        munmap(ptr + size, start + total - ptr - size);
+    }
+
+#ifdef MADV_HUGEPAGE
+    // fewer TLB misses on large buffers, silently ignored if not supported
+    madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+
+    return ptr;
+}
+
+/**
+ * Pre-fault pages to not pay for page faults while the buffer is used.
+ * It's done after the huge page advice, otherwise the region is populated
+ * with small pages.
+ * @param ptr pointer to the region
+ * @param size size of the region
+ */
+static void prefault(uint8_t* ptr, size_t size)
+{
+    const long page = sysconf(_SC_PAGESIZE);
+
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(ptr, size, MADV_POPULATE_WRITE) == 0) {
+        return;
+    }
+#endif
+
+    // not supported by the kernel (before 5.14), touch each page
+    for (size_t i = 0; i < size; i += page > 0 ? page : 4096) {
+        ptr[i] = 0;
+    }
+}
+
+/**
+ * Map new block of the size class.
+ * @param cls size class
+ * @return pointer to the block or NULL if not enough memory
+ */
+static struct block* map_block(size_t cls)
+{
+    const size_t size = class_size(cls);
+    uint8_t* ptr;
+
+    if (size >= HUGE_PAGE_SIZE) {
+        ptr = map_aligned(size);
+        if (!ptr) {
+            return NULL;
+        }
+    } else {
+        ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            return NULL;
+        }
+    }
+
+    prefault(ptr, size);
+
+    return (struct block*)ptr;
+}
+
+void* pool_alloc(size_t size)
+{
+    const size_t total = size + HEADER_SIZE;
+    struct block* blk = NULL;
+    size_t cls;
+
+    if (total <= (size_t)1 << MIN_SHIFT) {
+        blk = malloc(total);
+        if (!blk) {
+            return NULL;
+        }
+        blk->cls = 0;
+        return (uint8_t*)blk + HEADER_SIZE;
+    }
+
+    if (total < size || total > class_size(NUM_CLASSES - 1)) {
+        return NULL; // too big
+    }
+    cls = size_class(total);
+
+    pthread_mutex_lock(&pool.lock);
+    if (pool.free[cls]) {
+        blk = pool.free[cls];
+        pool.free[cls] = blk->next;
+        --pool.count[cls];
+    }
+    pthread_mutex_unlock(&pool.lock);
+
+    if (!blk) {
+        blk = map_block(cls);
+        if (!blk) {
+            return NULL;
+        }
+    }
+
+    blk->cls = cls + 1;
+    return (uint8_t*)blk + HEADER_SIZE;
+}
+
+void pool_free(void* ptr)
+{
+    struct block* blk;
+    size_t cls;
+    bool keep = false;
+
+    if (!ptr) {
+        return;
+    }
+
+    blk = (struct block*)((uint8_t*)ptr - HEADER_SIZE);
+    if (blk->cls == 0) {
+        free(blk);
+        return;
+    }
+    cls = blk->cls - 1;
+
+    pthread_mutex_lock(&pool.lock);
+    if (pool.count[cls] < MAX_FREE) {
+        blk->next = pool.free[cls];
+        pool.free[cls] = blk;
+        ++pool.count[cls];
+        keep = true;
+    }
+    pthread_mutex_unlock(&pool.lock);
+
+    if (!keep) {
+        munmap(blk, class_size(cls));
+    }
+}
+
+void pool_purge(void)
+{
+    pthread_mutex_lock(&pool.lock);
+    for (size_t cls = 0; cls < NUM_CLASSES; ++cls) {
+        while (pool.free[cls]) {
+            struct block* blk = pool.free[cls];
+            pool.free[cls] = blk->next;
+            munmap(blk, class_size(cls));
+        }
+        pool.count[cls] = 0;
+    }
+    pthread_mutex_unlock(&pool.lock);
+}
@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: MIT
+// Pool of reusable memory buffers.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * Allocate buffer: large buffers are taken from the pool of previously
+ * released ones with the same size class or mapped and pre-faulted, small
+ * ones are allocated from the heap. The function is thread safe.
+ * @param size buffer size in bytes
+ * @return pointer to the uninitialized buffer or NULL if not enough memory
+ */
+void* pool_alloc(size_t size);
+
+/**
+ * Release buffer: large buffers are kept in the pool for reuse.
+ * @param ptr pointer to the buffer allocated by pool_alloc(), can be NULL
+ */
+void pool_free(void* ptr);
+
+/**
+ * Unmap all buffers kept in the pool.
+ */
+void pool_purge(void);
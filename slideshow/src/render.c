@@ -0,0 +1,330 @@
+// SPDX-License-Identifier: MIT
+// Image renderer.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#include "render.h"
+
+#include "blur.h"
+#include "image.h"
+#include "pool.h"
+#include "scale.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** Downscale factor of the image copy used for blurred background. */
+#define BLUR_SCALE 8
+/** Background blur strength relative to the frame buffer width. */
+#define BLUR_SIGMA 0.01f
+/** Number of source rows per row of the small copy, the rest is skipped. */
+#define BLUR_ROWS 2
+
+/**
+ * Get rectangle to fit the image into the frame buffer.
+ * @param img image to draw
+ * @param fb destination frame buffer
+ * @param rect output rectangle
+ */
+static void fit_rect(const struct image* img, const struct buffer* fb,
+                     struct rect* rect)
+{
+    const float scale_w = (float)fb->width / img->width;
+    const float scale_h = (float)fb->height / img->height;
+    const float scale = scale_w < scale_h ? scale_w : scale_h;
+
+    rect->width = (float)img->width * scale;
+    rect->height = (float)img->height * scale;
+    if (rect->width == 0) {
+        rect->width = 1;
+    }
+    if (rect->height == 0) {
+        rect->height = 1;
+    }
+    rect->x = fb->width / 2 - rect->width / 2;
+    rect->y = fb->height / 2 - rect->height / 2;
+}
+
+/**
+ * Fill frame buffer area outside the rectangle with black: only the
+ * previously drawn area is cleared, the rest of the buffer is black already.
+ * @param fb frame buffer to clear
+ * @param rect image rectangle
+ */
+static void clear_background(struct buffer* fb, const struct rect* rect)
+{
+    const struct rect* drawn = &fb->drawn;
+    const size_t right = rect->x + rect->width;
+    const size_t bottom = rect->y + rect->height;
+    const size_t drawn_right = drawn->x + drawn->width;
+
+    for (size_t y = drawn->y; y < drawn->y + drawn->height; ++y) {
+        xrgb_t* line = (xrgb_t*)(fb->data + y * fb->stride);
+        if (y < rect->y || y >= bottom) {
+            memset(line + drawn->x, 0, drawn->width * sizeof(xrgb_t));
+            continue;
+        }
+        if (drawn->x < rect->x) {
+            const size_t end = drawn_right < rect->x ? drawn_right : rect->x;
+            memset(line + drawn->x, 0, (end - drawn->x) * sizeof(xrgb_t));
+        }
+        if (drawn_right > right) {
+            const size_t start = drawn->x > right ? drawn->x : right;
+            memset(line + start, 0, (drawn_right - start) * sizeof(xrgb_t));
+        }
+    }
+
+    fb->drawn = *rect;
+}
+
+/** Render job context. */
+struct render {
+    struct image* img;                       ///< Source image
+    size_t num;                              ///< Number of frame buffers
+    struct buffer* fbs[DISPLAY_MAX_OUTPUTS]; ///< Destination frame buffers
+    struct rect rects[DISPLAY_MAX_OUTPUTS];  ///< Image positions
+    scaler* scalers[DISPLAY_MAX_OUTPUTS];    ///< Scalers for each buffer
+    xrgb_t* row;                             ///< Decoded row buffer
+    struct buffer thumb;                     ///< Small copy for background
+    scaler* thumb_scaler;                    ///< Scaler for the small copy
+    size_t thumb_step;                       ///< Source rows sampling step
+    float sigma;                             ///< Background blur strength
+};
+
+/**
+ * Create small copy of the image used as blurred background.
+ * @param job render job
+ * @param width,height size of the largest frame buffer
+ * @return false if not enough memory
+ */
+static bool create_thumb(render* job, size_t width, size_t height)
+{
+    const struct image* img = job->img;
+    const float scale_w = (float)width / img->width;
+    const float scale_h = (float)height / img->height;
+    const float scale =
+        (scale_w > scale_h ? scale_w : scale_h) / BLUR_SCALE;
+    struct buffer* thumb = &job->thumb;
+    struct rect rect = { 0 };
+
+    // downscale only
+    thumb->width = scale < 1.0f ? img->width * scale : img->width;
+    thumb->height = scale < 1.0f ? img->height * scale : img->height;
+    if (thumb->width == 0) {
+        thumb->width = 1;
+    }
+    if (thumb->height == 0) {
+        thumb->height = 1;
+    }
+    thumb->stride = thumb->width * sizeof(xrgb_t);
+    thumb->size = thumb->stride * thumb->height;
+    thumb->data = pool_alloc(thumb->size);
+    if (!thumb->data) {
+        return false;
+    }
+
+    // the copy is blurred anyway, so skip most of the source rows to save
+    // time on the horizontal downscale
+    job->thumb_step = img->height / (thumb->height * BLUR_ROWS);
+    if (job->thumb_step == 0) {
+        job->thumb_step = 1;
+    }
+
+    rect.width = thumb->width;
+    rect.height = thumb->height;
+    job->thumb_scaler = scaler_init(
+        img->width, (img->height + job->thumb_step - 1) / job->thumb_step,
+        thumb, &rect);
+    job->sigma = (float)width * BLUR_SIGMA / BLUR_SCALE;
+
+    return job->thumb_scaler;
+}
+
+/**
+ * Get size of the largest frame buffer.
+ * @param fbs array of frame buffers
+ * @param num number of frame buffers in the array
+ * @param width,height output size
+ */
+static void largest_fb(struct buffer** fbs, size_t num, size_t* width,
+                       size_t* height)
+{
+    *width = 0;
+    *height = 0;
+    for (size_t i = 0; i < num; ++i) {
+        if (fbs[i]->width * fbs[i]->height > *width * *height) {
+            *width = fbs[i]->width;
+            *height = fbs[i]->height;
+        }
+    }
+}
+
+/**
+ * Create render job for the opened image.
+ * @param img source image, the job takes ownership
+ * @param fbs array of destination frame buffers
+ * @param num number of frame buffers in the array
+ * @param bkg background fill mode
+ * @return render job or NULL on errors
+ */
+static render* begin(struct image* img, struct buffer** fbs, size_t num,
+                     enum background bkg)
+{
+    render* job;
+    size_t max_w, max_h;
+    bool bars = false;
+
+    job = calloc(1, sizeof(*job));
+    if (!job) {
+        image_close(img);
+        return NULL;
+    }
+    job->img = img;
+    job->num = num > DISPLAY_MAX_OUTPUTS ? DISPLAY_MAX_OUTPUTS : num;
+
+    for (size_t i = 0; i < job->num; ++i) {
+        struct rect* rect = &job->rects[i];
+        job->fbs[i] = fbs[i];
+        fit_rect(img, fbs[i], rect);
+        // rows are written right away, so the area must be cleared later
+        // even if rendering fails or is canceled
+        rect_join(&fbs[i]->drawn, rect);
+        job->scalers[i] = scaler_init(img->width, img->height, fbs[i], rect);
+        if (!job->scalers[i]) {
+            goto fail;
+        }
+        if (rect->width != fbs[i]->width || rect->height != fbs[i]->height) {
+            bars = true;
+        }
+    }
+    // blurred copy is needed only if there are bars to fill
+    largest_fb(fbs, job->num, &max_w, &max_h);
+    if (bkg == BKG_BLUR && bars && !create_thumb(job, max_w, max_h)) {
+        goto fail;
+    }
+    // raw pixels can be put to the scalers directly, others need a buffer
+    // unless decoder can write to the frame buffer
+    if (!img->pixels &&
+        (job->num != 1 || job->thumb_scaler ||
+         !scaler_direct(job->scalers[0]))) {
+        job->row = pool_alloc(img->width * sizeof(xrgb_t));
+        if (!job->row) {
+            goto fail;
+        }
+    }
+
+    return job;
+
+fail:
+    render_end(job);
+    return NULL;
+}
+
+render* render_begin(const char* path, struct buffer** fbs, size_t num,
+                     enum background bkg, bool* corrupt)
+{
+    struct image* img;
+    size_t hint_w, hint_h;
+
+    // decode for the largest output
+    largest_fb(fbs, num, &hint_w, &hint_h);
+    img = image_open(path, hint_w, hint_h, false, corrupt);
+
+    return img ? begin(img, fbs, num, bkg) : NULL;
+}
+
+render* render_begin_pixels(const xrgb_t* data, size_t width, size_t height,
+                            size_t stride, struct buffer** fbs, size_t num,
+                            enum background bkg)
+{
+    struct image* img = image_wrap(data, width, height, stride);
+    return img ? begin(img, fbs, num, bkg) : NULL;
+}
+
+const char* render_date(const render* job)
+{
+    return job->img->date;
+}
+
+enum render_state render_step(render* job, size_t rows)
+{
+    struct image* img = job->img;
+
+    // decode image row by row and put it to all scalers
+    for (size_t n = 0; img->row < img->height && (!rows || n < rows); ++n) {
+        xrgb_t* dst = job->row ? job->row : scaler_direct(job->scalers[0]);
+        const xrgb_t* src = dst;
+        if (dst) {
+            if (!image_read(img, dst)) {
+                return img->corrupt ? RENDER_CORRUPT : RENDER_ERROR;
+            }
+        } else {
+            src = (const xrgb_t*)(img->pixels + img->row * img->stride);
+            ++img->row;
+        }
+        for (size_t i = 0; i < job->num; ++i) {
+            scaler_push(job->scalers[i], src);
+        }
+        if (job->thumb_scaler && (img->row - 1) % job->thumb_step == 0) {
+            scaler_push(job->thumb_scaler, src);
+        }
+    }
+
+    if (img->row < img->height) {
+        return RENDER_PROGRESS;
+    }
+
+    // black bars if there is not enough memory to blur
+    if (job->thumb_scaler) {
+        struct buffer* thumb = &job->thumb;
+        const bool blurred = blur(thumb->data, thumb->width, thumb->height,
+                                  thumb->stride, sizeof(xrgb_t), job->sigma);
+        for (size_t i = 0; i < job->num; ++i) {
+            if (!blurred || !blur_fill(job->fbs[i], &job->rects[i], thumb)) {
+                clear_background(job->fbs[i], &job->rects[i]);
+            }
+        }
+    } else {
+        for (size_t i = 0; i < job->num; ++i) {
+            clear_background(job->fbs[i], &job->rects[i]);
+        }
+    }
+
+    return RENDER_DONE;
+}
+
+void render_end(render* job)
+{
+    if (job) {
+        pool_free(job->row);
+        for (size_t i = 0; i < job->num; ++i) {
+            scaler_free(job->scalers[i]);
+        }
+        scaler_free(job->thumb_scaler);
+        pool_free(job->thumb.data);
+        image_close(job->img);
+        free(job);
+    }
+}
+
+bool render_image(const char* path, struct buffer** fbs, size_t num,
+                  enum background bkg)
+{
+    struct image* img;
+    size_t hint_w, hint_h;
+    render* job = NULL;
+    bool rc = false;
+
+    // the image is not drawn progressively, so it can be oriented
+    largest_fb(fbs, num, &hint_w, &hint_h);
+    img = image_open(path, hint_w, hint_h, true, NULL);
+    if (img) {
+        job = begin(img, fbs, num, bkg);
+    }
+
+    if (job) {
+        rc = render_step(job, 0) == RENDER_DONE;
+        render_end(job);
+    }
+
+    return rc;
+}
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: MIT
+// Image renderer.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#pragma once
+
+#include "display.h"
+#include "image.h"
+
+#include <stdbool.h>
+
+/** Background fill mode. */
+enum background {
+    BKG_BLACK, ///< Fill with black color
+    BKG_BLUR,  ///< Fill with blurred copy of the image
+};
+
+/** Render job context. */
+typedef struct render render;
+
+/** Render job state. */
+enum render_state {
+    RENDER_PROGRESS, ///< Rendering in progress
+    RENDER_DONE,     ///< Image is completely drawn
+    RENDER_ERROR,    ///< Decoding failed
+    RENDER_CORRUPT,  ///< Decoding failed due to invalid image data
+};
+
+/**
+ * Start drawing image on the frame buffers, see render_image().
+ * @param path path to the image file
+ * @param fbs array of destination frame buffers
+ * @param num number of frame buffers in the array
+ * @param bkg background fill mode
+ * @param corrupt optional output flag set if the image can't be opened because
+ *                the file is invalid, see image_open()
+ * @return render job or NULL if image can not be opened
+ */
+render* render_begin(const char* path, struct buffer** fbs, size_t num,
+                     enum background bkg, bool* corrupt);
+
+/**
+ * Start drawing raw pixel data on the frame buffers, see render_begin().
+ * @param data pixel data, must stay valid until the job is finished
+ * @param width,height image size in pixels
+ * @param stride size of the image row in bytes
+ * @param fbs array of destination frame buffers
+ * @param num number of frame buffers in the array
+ * @param bkg background fill mode
+ * @return render job or NULL on errors
+ */
+render* render_begin_pixels(const xrgb_t* data, size_t width, size_t height,
+                            size_t stride, struct buffer** fbs, size_t num,
+                            enum background bkg);
+
+/**
+ * Get date of taking the photo, read from the image header.
+ * @param job render job
+ * @return date in format "YYYY:MM:DD HH:MM:SS", empty string if unknown
+ */
+const char* render_date(const render* job);
+
+/**
+ * Draw next part of the image.
+ * @param job render job
+ * @param rows max number of source rows to process, 0 to finish the job
+ * @return job state
+ */
+enum render_state render_step(render* job, size_t rows);
+
+/**
+ * Destroy render job.
+ * @param job render job
+ */
+void render_end(render* job);
+
+/**
+ * Draw image on the frame buffers: the image is decoded row by row and scaled
+ * to fit each frame buffer on the fly, so the whole image is never held in
+ * memory and is decoded only once regardless of the number of outputs.
+ * Unlike render_begin(), the EXIF orientation of the image is applied.
+ * @param path path to the image file
+ * @param fbs array of destination frame buffers
+ * @param num number of frame buffers in the array
+ * @param bkg background fill mode
+ * @return true if image was drawn successfully
+ */
+bool render_image(const char* path, struct buffer** fbs, size_t num,
+                  enum background bkg);
@@ -0,0 +1,262 @@
+// SPDX-License-Identifier: MIT
+// Streaming image scaler.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#include "scale.h"
+
+#include "pool.h"
+
+#include <string.h>
+
+/** Fixed point precision of reciprocals used in box filter. */
+#define RECIP_BITS 16
+
+/** Scaler context. */
+struct scaler {
+    struct buffer* fb; ///< Destination frame buffer
+    struct rect dst;   ///< Destination rectangle
+    size_t src_w;      ///< Source image width
+    size_t src_h;      ///< Source image height
+    size_t src_y;      ///< Index of the next source row
+    size_t dst_y;      ///< Index of the next destination row
+
+    /**
+     * Horizontal map:
+     * downscale: index of the first source pixel for each destination one,
+     * upscale: fixed point position in the source row.
+     */
+    uint32_t* xmap;
+    uint32_t* xrecip; ///< Reciprocals of the box filter size (downscale)
+
+    xrgb_t* prev;   ///< Previous horizontally scaled row
+    xrgb_t* curr;   ///< Current horizontally scaled row
+    uint32_t* vacc; ///< Vertical accumulator for box filter (downscale)
+    size_t vcount;  ///< Number of accumulated rows
+};
+
+/**
+ * Get fixed point position of the destination pixel center in the source.
+ * @param index destination pixel index
+ * @param src,dst source and destination sizes
+ * @return fixed point position
+ */
+static uint32_t bilinear_pos(size_t index, size_t src, size_t dst)
+{
+    const int64_t pos = ((int64_t)(index * 2 + 1) * (int64_t)src -
+                         (int64_t)dst) *
+        SCALE_FRAC_ONE / ((int64_t)dst * 2);
+    return pos > 0 ? pos : 0;
+}
+
+/**
+ * Get pointer to the frame buffer line.
+ * @param sc scaler context
+ * @param y line index inside the destination rectangle
+ * @return pointer to the first pixel of the destination rectangle
+ */
+static inline xrgb_t* dst_line(const scaler* sc, size_t y)
+{
+    uint8_t* line = sc->fb->data + (sc->dst.y + y) * sc->fb->stride;
+    return (xrgb_t*)line + sc->dst.x;
+}
+
+/**
+ * Scale source row horizontally.
+ * @param sc scaler context
+ * @param src source row
+ * @param dst destination row
+ */
+static void scale_row(const scaler* sc, const xrgb_t* src, xrgb_t* dst)
+{
+    const size_t width = sc->dst.width;
+
+    if (width == sc->src_w) {
+        memcpy(dst, src, width * sizeof(xrgb_t));
+    } else if (width < sc->src_w) {
+        // box filter
+        for (size_t x = 0; x < width; ++x) {
+            const uint32_t recip = sc->xrecip[x];
+            uint32_t r = 0, g = 0, b = 0;
+            for (size_t i = sc->xmap[x]; i < sc->xmap[x + 1]; ++i) {
+                const xrgb_t c = src[i];
+                r += (c >> 16) & 0xff;
+                g += (c >> 8) & 0xff;
+                b += c & 0xff;
+            }
+            r = (r * recip) >> RECIP_BITS;
+            g = (g * recip) >> RECIP_BITS;
+            b = (b * recip) >> RECIP_BITS;
+            dst[x] = ((xrgb_t)0xff << 24) | (r << 16) | (g << 8) | b;
+        }
+    } else {
+        // bilinear
+        const size_t last = sc->src_w - 1;
+        for (size_t x = 0; x < width; ++x) {
+            const size_t x0 = sc->xmap[x] >> SCALE_FRAC_BITS;
+            const size_t x1 = x0 < last ? x0 + 1 : last;
+            dst[x] =
+                scale_blend(src[x0], src[x1], sc->xmap[x] & SCALE_FRAC_MASK);
+        }
+    }
+}
+
+/**
+ * Vertical downscale: accumulate rows and flush them with box filter.
+ * @param sc scaler context
+ */
+static void push_down(scaler* sc)
+{
+    const size_t width = sc->dst.width;
+    const size_t end = (sc->dst_y + 1) * sc->src_h / sc->dst.height;
+
+    for (size_t x = 0; x < width; ++x) {
+        const xrgb_t c = sc->curr[x];
+        sc->vacc[x * 3 + 0] += (c >> 16) & 0xff;
+        sc->vacc[x * 3 + 1] += (c >> 8) & 0xff;
+        sc->vacc[x * 3 + 2] += c & 0xff;
+    }
+    ++sc->vcount;
+
+    if (sc->src_y + 1 == end) {
+        const uint32_t recip =
+            ((1 << RECIP_BITS) + sc->vcount - 1) / sc->vcount;
+        xrgb_t* dst = dst_line(sc, sc->dst_y);
+        for (size_t x = 0; x < width; ++x) {
+            const uint32_t r = (sc->vacc[x * 3 + 0] * recip) >> RECIP_BITS;
+            const uint32_t g = (sc->vacc[x * 3 + 1] * recip) >> RECIP_BITS;
+            const uint32_t b = (sc->vacc[x * 3 + 2] * recip) >> RECIP_BITS;
+            dst[x] = ((xrgb_t)0xff << 24) | (r << 16) | (g << 8) | b;
+        }
+        memset(sc->vacc, 0, width * 3 * sizeof(*sc->vacc));
+        sc->vcount = 0;
+        ++sc->dst_y;
+    }
+}
+
+/**
+ * Vertical upscale: put all destination rows between previous and current
+ * source rows.
+ * @param sc scaler context
+ */
+static void push_up(scaler* sc)
+{
+    const size_t width = sc->dst.width;
+    const size_t last = sc->src_h - 1;
+
+    while (sc->dst_y < sc->dst.height) {
+        const uint32_t pos = bilinear_pos(sc->dst_y, sc->src_h, sc->dst.height);
+        const size_t y0 = pos >> SCALE_FRAC_BITS;
+        const size_t y1 = y0 < last ? y0 + 1 : last;
+        xrgb_t* dst = dst_line(sc, sc->dst_y);
+
+        if (y1 > sc->src_y) {
+            break; // next source row required
+        }
+
+        if (y0 == y1) {
+            memcpy(dst, sc->curr, width * sizeof(xrgb_t));
+        } else {
+            const uint32_t f = pos & SCALE_FRAC_MASK;
+            for (size_t x = 0; x < width; ++x) {
+                dst[x] = scale_blend(sc->prev[x], sc->curr[x], f);
+            }
+        }
+
+        ++sc->dst_y;
+    }
+}
+
+scaler* scaler_init(size_t width, size_t height, struct buffer* fb,
+                    const struct rect* dst)
+{
+    const size_t xmap_sz = (dst->width + 1) * sizeof(uint32_t);
+    const size_t xrecip_sz = dst->width * sizeof(uint32_t);
+    const size_t row_sz = dst->width * sizeof(xrgb_t);
+    const size_t vacc_sz = dst->width * 3 * sizeof(uint32_t);
+    scaler* sc;
+    uint8_t* ptr;
+
+    if (!width || !height || !dst->width || !dst->height) {
+        return NULL;
+    }
+
+    sc = pool_alloc(sizeof(*sc) + xmap_sz + xrecip_sz + row_sz * 2 + vacc_sz);
+    if (!sc) {
+        return NULL;
+    }
+    memset(sc, 0, sizeof(*sc));
+
+    sc->fb = fb;
+    sc->dst = *dst;
+    sc->src_w = width;
+    sc->src_h = height;
+
+    ptr = (uint8_t*)sc + sizeof(*sc);
+    sc->xmap = (uint32_t*)ptr;
+    ptr += xmap_sz;
+    sc->xrecip = (uint32_t*)ptr;
+    ptr += xrecip_sz;
+    sc->prev = (xrgb_t*)ptr;
+    ptr += row_sz;
+    sc->curr = (xrgb_t*)ptr;
+    ptr += row_sz;
+    sc->vacc = (uint32_t*)ptr;
+    memset(sc->vacc, 0, vacc_sz);
+
+    // fill horizontal map
+    if (dst->width < width) {
+        for (size_t x = 0; x <= dst->width; ++x) {
+            sc->xmap[x] = x * width / dst->width;
+        }
+        for (size_t x = 0; x < dst->width; ++x) {
+            const size_t count = sc->xmap[x + 1] - sc->xmap[x];
+            sc->xrecip[x] = ((1 << RECIP_BITS) + count - 1) / count;
+        }
+    } else {
+        for (size_t x = 0; x < dst->width; ++x) {
+            sc->xmap[x] = bilinear_pos(x, width, dst->width);
+        }
+    }
+
+    return sc;
+}
+
+void scaler_free(scaler* sc)
+{
+    pool_free(sc);
+}
+
+xrgb_t* scaler_direct(scaler* sc)
+{
+    if (sc->src_w == sc->dst.width && sc->src_h == sc->dst.height &&
+        sc->src_y < sc->src_h) {
+        return dst_line(sc, sc->src_y);
+    }
+    return NULL;
+}
+
+void scaler_push(scaler* sc, const xrgb_t* row)
+{
+    if (sc->src_y >= sc->src_h) {
+        return;
+    }
+
+    if (sc->src_h == sc->dst.height) {
+        xrgb_t* dst = dst_line(sc, sc->src_y);
+        if (dst != row) {
+            scale_row(sc, row, dst);
+        }
+    } else {
+        xrgb_t* swap = sc->prev;
+        sc->prev = sc->curr;
+        sc->curr = swap;
+        scale_row(sc, row, sc->curr);
+        if (sc->dst.height < sc->src_h) {
+            push_down(sc);
+        } else {
+            push_up(sc);
+        }
+    }
+
+    ++sc->src_y;
+}
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: MIT
+// Streaming image scaler.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#pragma once
+
+#include "display.h"
+#include "image.h"
+
+/** Fixed point precision of interpolation weights. */
+#define SCALE_FRAC_BITS 8
+#define SCALE_FRAC_ONE  (1 << SCALE_FRAC_BITS)
+#define SCALE_FRAC_MASK (SCALE_FRAC_ONE - 1)
+
+/**
+ * Linear interpolation between two pixels.
+ * @param a,b pixels to blend
+ * @param f weight of the second pixel, [0, SCALE_FRAC_ONE]
+ * @return blended pixel
+ */
+static inline xrgb_t scale_blend(xrgb_t a, xrgb_t b, uint32_t f)
+{
+    const uint32_t nf = SCALE_FRAC_ONE - f;
+    const uint32_t rb =
+        ((a & 0xff00ff) * nf + (b & 0xff00ff) * f) >> SCALE_FRAC_BITS;
+    const uint32_t g =
+        ((a & 0x00ff00) * nf + (b & 0x00ff00) * f) >> SCALE_FRAC_BITS;
+    return ((xrgb_t)0xff << 24) | (rb & 0xff00ff) | (g & 0x00ff00);
+}
+
+/** Scaler context. */
+typedef struct scaler scaler;
+
+/**
+ * Create scaler.
+ * @param width,height size of the source image
+ * @param fb destination frame buffer
+ * @param dst destination rectangle inside the frame buffer
+ * @return scaler context or NULL if error
+ */
+scaler* scaler_init(size_t width, size_t height, struct buffer* fb,
+                    const struct rect* dst);
+
+/**
+ * Destroy scaler context.
+ * @param sc scaler context
+ */
+void scaler_free(scaler* sc);
+
+/**
+ * Get pointer to the frame buffer line that can be used as decoder output.
+ * Available only if the source image has the same size as the destination.
+ * @param sc scaler context
+ * @return pointer to the destination line or NULL if direct output is not
+ *         possible
+ */
+xrgb_t* scaler_direct(scaler* sc);
+
+/**
+ * Put next source row to the scaler, the output is written to the frame
+ * buffer as soon as all required source rows are received.
+ * @param sc scaler context
+ * @param row source row, the width is the same as source image has
+ */
+void scaler_push(scaler* sc, const xrgb_t* row);
@@ -2,103 +2,886 @@
 // Slide show.
 // Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
 
+// Linux specific fcntl commands: F_GET_SEALS
+#define _GNU_SOURCE
+
 #include "sshow.h"
 
+#include "font.h"
 #include "image.h"
+#include "input.h"
+#include "mipmap.h"
+#include "render.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <linux/dma-buf.h>
+
 #ifdef NDEBUG
 #define PHOTO_DELAY 5
 #else
 #define PHOTO_DELAY 1
 #endif
 
+/** Number of already shown slides kept in frame buffers. */
+#define HISTORY_FRAMES 2
+/** Number of slides rendered in advance. */
+#define PREFETCH_FRAMES (DISPLAY_BUFFERS - HISTORY_FRAMES - 1)
+/** Number of paths to the already shown slides. */
+#define HISTORY_PATHS 64
+/** Number of source rows decoded between input polls while prefetching. */
+#define PREFETCH_ROWS 32
+/** Max time to wait for the pending page flip (milliseconds). */
+#define FLIP_TIMEOUT 1000
+
+/** Caption color. */
+#define CAPTION_COLOR 0xffcccccc
+/** Caption margin from the bottom right corner (pixels). */
+#define CAPTION_MARGIN 10
+/** Caption shadow blur. */
+#define CAPTION_SHADOW 4.0f
+/** Default caption font size relative to the output height. */
+#define CAPTION_SCALE 27
+
+/** Max zoom of the pan and zoom animation. */
+#define KENBURNS_ZOOM 1.25f
+
+/** Slide description. */
+struct slide {
+    char* path;                ///< Path to the image file
+    bool listed;               ///< Path was taken from the image list
+    char date[IMAGE_DATE_LEN]; ///< Date of taking the photo, empty if unknown
+};
+
+/** Pan and zoom animation of the slide. */
+struct motion {
+    mipmap* mm;    ///< Image pyramid, NULL if the slide is static
+    float zoom[2]; ///< Start and end zoom, [1, KENBURNS_ZOOM]
+    float x[2];    ///< Start and end horizontal position, [0, 1]
+    float y[2];    ///< Start and end vertical position, [0, 1]
+    bool animated; ///< Frame buffer is overwritten by the animation
+};
+
+/**
+ * Sequence of slides shown on one or more outputs.
+ * Slides are numbered from 1, the frame buffer used for the slide is
+ * determined by its number, so the ring of buffers holds a few previous
+ * slides, the current one and the prefetched next ones. The animated slide
+ * takes the oldest history buffer to alternate its frames with.
+ */
+struct channel {
+    imglist* list;                          ///< Image list
+    size_t first;                           ///< Index of the first output
+    size_t num;                             ///< Number of outputs
+    enum background bkg;                    ///< Letterbox fill mode
+    const font* font;                       ///< Caption font, NULL to disable
+    struct slide slides[HISTORY_PATHS];     ///< Known slides
+    size_t last;                            ///< Number of the last known slide
+    size_t current;                         ///< Number of the displayed slide
+    size_t frames[DISPLAY_BUFFERS];         ///< Slide numbers drawn in buffers
+    render* job;                            ///< Prefetch job
+    size_t job_slide;                       ///< Slide number of prefetch job
+    bool kenburns;                          ///< Pan and zoom animation
+    struct motion motions[DISPLAY_BUFFERS]; ///< Animations of drawn slides
+    struct text* caption;                   ///< Caption of the animated slide
+    size_t front;                           ///< Buffer with the last frame
+    uint64_t start;                         ///< Animation start time, 0 if done
+    uint64_t paused;                        ///< Animation pause time
+};
+
 /** Stop flag. */
 static bool stop_slideshow;
 
 /**
- * Draw image 1:1.
- * @param img image to draw
- * @return fb destination frame buffer
+ * Get current monotonic time.
+ * @return time in milliseconds
+ */
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Set path for the slide.
+ * @param ch pointer to the channel
+ * @param num slide number
+ * @param path path to the image file, NULL to remove the slide
+ * @param listed flag: the path was taken from the image list
+ * @return false if slide was removed
+ */
+static bool set_slide(struct channel* ch, size_t num, const char* path,
+                      bool listed)
+{
+    struct slide* slide = &ch->slides[num % HISTORY_PATHS];
+    const size_t len = path ? strlen(path) + 1 : 0;
+    char* copy = len ? malloc(len) : NULL;
+
+    free(slide->path);
+    slide->path = NULL;
+    slide->date[0] = 0;
+
+    if (copy) {
+        memcpy(copy, path, len);
+        slide->path = copy;
+        slide->listed = listed;
+    }
+
+    return slide->path;
+}
+
+/**
+ * Get slide, load next path from the list if needed.
+ * @param ch pointer to the channel
+ * @param num slide number
+ * @return pointer to the slide or NULL if it's unknown
+ */
+static struct slide* get_slide(struct channel* ch, size_t num)
+{
+    if (num == 0 || num > ch->last + 1 ||
+        (num <= ch->last && ch->last - num >= HISTORY_PATHS)) {
+        return NULL;
+    }
+
+    if (num == ch->last + 1) {
+        if (!set_slide(ch, num, imglist_next(ch->list), true)) {
+            return NULL;
+        }
+        ch->last = num;
+    }
+
+    return &ch->slides[num % HISTORY_PATHS];
+}
+
+/**
+ * Handle slide that can not be drawn.
+ * @param ch pointer to the channel
+ * @param num slide number
+ * @param corrupt flag of invalid image data, only such images are recorded
+ *                as broken, other errors may be temporary
+ * @return true if the slide was replaced by the next image from the list
  */
-static void copy_image(const struct image* img, struct buffer* fb)
+static bool drop_slide(struct channel* ch, size_t num, bool corrupt)
 {
-    const size_t stride = img->width * sizeof(xrgb_t);
-    if (stride == fb->stride) {
-        memcpy(fb->data, img->data, img->height * stride);
+    const struct slide* slide = &ch->slides[num % HISTORY_PATHS];
+
+    if (num == ch->last && slide->listed) {
+        // remove broken image from the list and use the next one
+        return set_slide(ch, num, imglist_skip(ch->list, corrupt), true);
+    }
+
+    if (num == ch->last) {
+        --ch->last;
+    }
+
+    return false;
+}
+
+/**
+ * Compose caption text for the slide: directory name and date.
+ * @param slide slide description
+ * @param text output buffer
+ * @param size size of the output buffer
+ */
+static void caption_text(const struct slide* slide, char* text, size_t size)
+{
+    const char* path = slide->path;
+    char date[IMAGE_DATE_LEN];
+    const char* dir = path;
+    const char* end = strrchr(path, '/');
+    struct stat st;
+
+    // name of the parent directory
+    if (end) {
+        dir = end;
+        while (dir > path && dir[-1] != '/') {
+            --dir;
+        }
     } else {
-        for (size_t y = 0; y < fb->height; ++y) {
-            xrgb_t* img_ptr = &img->data[y * img->width];
-            uint8_t* buf_ptr = &fb->data[y * fb->stride];
-            memcpy(buf_ptr, img_ptr, stride);
+        end = path;
+    }
+
+    // date of taking the photo or file modification time
+    if (slide->date[0]) {
+        memcpy(date, slide->date, sizeof(date));
+        date[4] = date[7] = '-';
+        date[10] = 0;
+    } else if (stat(path, &st) == 0) {
+        struct tm tm;
+        localtime_r(&st.st_mtime, &tm);
+        strftime(date, sizeof(date), "%Y-%m-%d", &tm);
+    } else {
+        date[0] = 0;
+    }
+
+    snprintf(text, size, "%.*s%s%s", (int)(end - dir), dir,
+             end > dir && date[0] ? ", " : "", date);
+}
+
+/**
+ * Render caption text for the slide.
+ * @param ch pointer to the channel
+ * @param num slide number
+ * @return rendered text or NULL if caption is disabled
+ */
+static struct text* render_caption(const struct channel* ch, size_t num)
+{
+    const struct slide* slide = &ch->slides[num % HISTORY_PATHS];
+    char str[NAME_MAX + IMAGE_DATE_LEN + 3];
+
+    if (!ch->font || !slide->path) {
+        return NULL;
+    }
+
+    caption_text(slide, str, sizeof(str));
+    if (!str[0]) {
+        return NULL;
+    }
+
+    return font_render(ch->font, str, CAPTION_SHADOW);
+}
+
+/**
+ * Draw caption in the bottom right corner of the frame buffer: only the text
+ * box is blended, the rest of the frame buffer is not touched.
+ * @param text rendered caption text
+ * @param fb destination frame buffer
+ */
+static void put_caption(const struct text* text, struct buffer* fb)
+{
+    if (text->width + CAPTION_MARGIN <= fb->width &&
+        text->height + CAPTION_MARGIN <= fb->height) {
+        font_draw(text, fb, fb->width - text->width - CAPTION_MARGIN,
+                  fb->height - text->height - CAPTION_MARGIN, CAPTION_COLOR);
+    }
+}
+
+/**
+ * Draw caption over the rendered slide.
+ * @param ch pointer to the channel
+ * @param display pointer to the display context
+ * @param num slide number
+ */
+static void draw_caption(struct channel* ch, display* display, size_t num)
+{
+    struct text* text = render_caption(ch, num);
+
+    if (text) {
+        for (size_t i = 0; i < ch->num; ++i) {
+            put_caption(text, display_draw(display, ch->first + i,
+                                           num % DISPLAY_BUFFERS));
         }
+        font_text_free(text);
     }
 }
 
 /**
- * Draw scaled image.
- * @param img image to draw
- * @return fb destination frame buffer
+ * Get random number.
+ * @return random number in range [0, 1]
  */
-static void scale_image(const struct image* img, struct buffer* fb)
+static float random_unit(void)
 {
-    const float scale_w = (float)fb->width / img->width;
-    const float scale_h = (float)fb->height / img->height;
-    const float scale = scale_w < scale_h ? scale_w : scale_h;
+    return (float)rand() / RAND_MAX;
+}
+
+/**
+ * Draw frame of the pan and zoom animation.
+ * @param ch pointer to the channel
+ * @param display pointer to the display context
+ * @param slot index of the buffer the animated slide belongs to
+ * @param index index of the destination frame buffers
+ * @param t animation progress, [0, 1]
+ */
+static void draw_motion(struct channel* ch, display* display, size_t slot,
+                        size_t index, float t)
+{
+    struct motion* mo = &ch->motions[slot];
+    const struct buffer* canvas = mipmap_base(mo->mm);
+    const float zoom = mo->zoom[0] + (mo->zoom[1] - mo->zoom[0]) * t;
+    const float px = mo->x[0] + (mo->x[1] - mo->x[0]) * t;
+    const float py = mo->y[0] + (mo->y[1] - mo->y[0]) * t;
+
+    for (size_t i = 0; i < ch->num; ++i) {
+        struct buffer* fb = display_draw(display, ch->first + i, index);
+        const float fit_w = (float)canvas->width / fb->width;
+        const float fit_h = (float)canvas->height / fb->height;
+        const float scale = (fit_w < fit_h ? fit_w : fit_h) / zoom;
+        const float x = (canvas->width - fb->width * scale) * px;
+        const float y = (canvas->height - fb->height * scale) * py;
+        mipmap_draw(mo->mm, fb, x, y, scale);
+    }
+}
 
-    const size_t dst_w = (float)img->width * scale;
-    const size_t dst_h = (float)img->height * scale;
-    const size_t dst_x1 = fb->width / 2 - dst_w / 2;
-    const size_t dst_y1 = fb->height / 2 - dst_h / 2;
-    const size_t dst_x2 = dst_x1 + dst_w;
-    const size_t dst_y2 = dst_y1 + dst_h;
+/**
+ * Mark slide as completely drawn.
+ * @param ch pointer to the channel
+ * @param display pointer to the display context
+ * @param num slide number
+ */
+static void finish_slide(struct channel* ch, display* display, size_t num)
+{
+    const size_t index = num % DISPLAY_BUFFERS;
+    struct motion* mo = &ch->motions[index];
 
-    // clear background
-    memset(fb->data, 0, dst_y1 * fb->stride);
-    memset(fb->data + dst_y2 * fb->stride, 0,
-           (fb->height - dst_y2) * fb->stride);
+    if (mo->mm) {
+        // zoom in or out, the view moves between two random points
+        const bool zoom_in = rand() & 1;
+        mo->zoom[0] = zoom_in ? 1.0f : KENBURNS_ZOOM;
+        mo->zoom[1] = zoom_in ? KENBURNS_ZOOM : 1.0f;
+        mo->x[0] = random_unit();
+        mo->x[1] = random_unit();
+        mo->y[0] = random_unit();
+        mo->y[1] = random_unit();
+        mo->animated = false;
+        mipmap_build(mo->mm);
+        draw_motion(ch, display, index, index, 0.0f);
+    }
 
-    for (size_t y = dst_y1; y < dst_y2; ++y) {
-        const size_t img_y = (float)(y - dst_y1) / scale;
-        const xrgb_t* img_line = &img->data[img_y * img->width];
-        uint8_t* buf_line = &fb->data[y * fb->stride];
+    draw_caption(ch, display, num);
+    ch->frames[index] = num;
+}
 
-        // clear background
-        memset(buf_line, 0, dst_x1 * sizeof(uint32_t));
-        memset(buf_line + dst_x2, 0, (fb->width - dst_x2) * sizeof(uint32_t));
+/**
+ * Create image pyramid for the animated slide, the base level is larger than
+ * the frame buffers, so the maximum zoom doesn't upscale the image.
+ * @param ch pointer to the channel
+ * @param fbs array of destination frame buffers
+ * @return image pyramid or NULL if not enough memory
+ */
+static mipmap* create_pyramid(const struct channel* ch, struct buffer** fbs)
+{
+    size_t max_w = 0, max_h = 0;
+    size_t min_w = SIZE_MAX, min_h = SIZE_MAX;
 
-        for (size_t x = dst_x1; x < dst_x2; ++x) {
-            const size_t img_x = (float)(x - dst_x1) / scale;
-            *(uint32_t*)&buf_line[x * sizeof(uint32_t)] = img_line[img_x];
+    for (size_t i = 0; i < ch->num; ++i) {
+        const struct buffer* fb = fbs[i];
+        if (fb->width * fb->height > max_w * max_h) {
+            max_w = fb->width;
+            max_h = fb->height;
+        }
+        if (fb->width * fb->height < min_w * min_h) {
+            min_w = fb->width;
+            min_h = fb->height;
         }
     }
+
+    return mipmap_create(max_w * KENBURNS_ZOOM, max_h * KENBURNS_ZOOM, min_w,
+                         min_h);
 }
 
 /**
- * Load next image from the list.
- * @param list pointer to the image list context
- * @return image instance or NULL on errors
+ * Start rendering the slide.
+ * @param ch pointer to the channel
+ * @param display pointer to the display context
+ * @param num slide number
+ * @return render job or NULL if no more images
  */
-static struct image* next_image(imglist* list)
+static render* begin_slide(struct channel* ch, display* display, size_t num)
 {
-    struct image* img = NULL;
-    const char* path = imglist_next(list);
+    const size_t index = num % DISPLAY_BUFFERS;
+    struct motion* mo = &ch->motions[index];
+    struct buffer* fbs[DISPLAY_MAX_OUTPUTS];
+    size_t num_fbs = ch->num;
+    struct slide* slide;
+    render* job = NULL;
+
+    for (size_t i = 0; i < ch->num; ++i) {
+        fbs[i] = display_draw(display, ch->first + i, index);
+    }
+
+    // the frame buffer is going to be overwritten
+    ch->frames[index] = 0;
 
-    while (path) {
-        img = image_load(path);
-        if (img) {
-            return img;
+    // animated slide is drawn on the pyramid, the frame buffers are filled
+    // from it when the image is decoded
+    if (ch->kenburns && !mo->mm) {
+        mo->mm = create_pyramid(ch, fbs);
+    }
+    if (mo->mm) {
+        fbs[0] = mipmap_base(mo->mm);
+        num_fbs = 1;
+    }
+
+    slide = get_slide(ch, num);
+    while (slide && slide->path && !job) {
+        bool corrupt;
+        job = render_begin(slide->path, fbs, num_fbs, ch->bkg, &corrupt);
+        if (!job && !drop_slide(ch, num, corrupt)) {
+            slide = NULL;
         }
-        path = imglist_skip(list);
+    }
+    if (job) {
+        // the caption is drawn when the image is decoded
+        memcpy(slide->date, render_date(job), sizeof(slide->date));
     }
 
-    fprintf(stderr, "No more images in the list\n");
-    return NULL;
+    return job;
+}
+
+/**
+ * Cancel prefetch job.
+ * @param ch pointer to the channel
+ */
+static void cancel_prefetch(struct channel* ch)
+{
+    render_end(ch->job);
+    ch->job = NULL;
+    ch->job_slide = 0;
+}
+
+/**
+ * Draw slide synchronously.
+ * @param ch pointer to the channel
+ * @param display pointer to the display context
+ * @param num slide number
+ * @return false if slide can not be drawn
+ */
+static bool draw_slide(struct channel* ch, display* display, size_t num)
+{
+    const size_t index = num % DISPLAY_BUFFERS;
+    struct motion* mo = &ch->motions[index];
+
+    if (ch->frames[index] == num) {
+        if (mo->animated) {
+            // restore the first frame of the animation
+            mo->animated = false;
+            draw_motion(ch, display, index, index, 0.0f);
+            draw_caption(ch, display, num);
+        }
+        return true; // already drawn
+    }
+
+    // finish or cancel prefetch that uses the same frame buffer
+    if (ch->job && ch->job_slide % DISPLAY_BUFFERS == index) {
+        if (ch->job_slide == num &&
+            render_step(ch->job, 0) == RENDER_DONE) {
+            finish_slide(ch, display, num);
+        }
+        cancel_prefetch(ch);
+    }
+
+    while (ch->frames[index] != num) {
+        render* job = begin_slide(ch, display, num);
+        enum render_state state;
+        if (!job) {
+            return false;
+        }
+        state = render_step(job, 0);
+        if (state == RENDER_DONE) {
+            finish_slide(ch, display, num);
+        } else if (!drop_slide(ch, num, state == RENDER_CORRUPT)) {
+            render_end(job);
+            return false;
+        }
+        render_end(job);
+    }
+
+    return true;
+}
+
+/**
+ * Free image pyramids of the history slides: each one is larger than the
+ * frame buffers, so only the current and the next slides keep them. History
+ * slides with a pyramid are drawn again if they are shown back.
+ * @param ch pointer to the channel
+ */
+static void release_motions(struct channel* ch)
+{
+    const size_t current = ch->current % DISPLAY_BUFFERS;
+    const size_t next = (ch->current + 1) % DISPLAY_BUFFERS;
+
+    for (size_t i = 0; i < DISPLAY_BUFFERS; ++i) {
+        struct motion* mo = &ch->motions[i];
+        if (i == current || i == next || !mo->mm) {
+            continue;
+        }
+        if (ch->job && ch->job_slide % DISPLAY_BUFFERS == i) {
+            cancel_prefetch(ch);
+        }
+        mipmap_free(mo->mm);
+        mo->mm = NULL;
+        mo->animated = false;
+        ch->frames[i] = 0;
+    }
+}
+
+/**
+ * Start animation of the current slide.
+ * @param ch pointer to the channel
+ */
+static void start_motion(struct channel* ch)
+{
+    const size_t index = ch->current % DISPLAY_BUFFERS;
+    // the oldest history buffer is used as the second animation buffer
+    const size_t back =
+        (ch->current + DISPLAY_BUFFERS - HISTORY_FRAMES) % DISPLAY_BUFFERS;
+
+    release_motions(ch);
+
+    font_text_free(ch->caption);
+    ch->caption = NULL;
+    ch->front = index;
+    ch->start = 0;
+
+    if (!ch->motions[index].mm || ch->frames[index] != ch->current) {
+        return; // static slide
+    }
+
+    if (ch->job && ch->job_slide % DISPLAY_BUFFERS == back) {
+        cancel_prefetch(ch);
+    }
+    ch->frames[back] = 0;
+
+    ch->caption = render_caption(ch, ch->current);
+    ch->start = now_ms();
+    if (ch->paused) {
+        ch->paused = ch->start;
+    }
+}
+
+/**
+ * Freeze or continue the animation.
+ * @param ch pointer to the channel
+ * @param pause true to freeze the animation
+ */
+static void pause_motion(struct channel* ch, bool pause)
+{
+    const uint64_t now = now_ms();
+
+    if (pause) {
+        ch->paused = now;
+    } else if (ch->paused) {
+        if (ch->start) {
+            ch->start += now - ch->paused;
+        }
+        ch->paused = 0;
+    }
+}
+
+/**
+ * Draw next frame of the animation, must be called when all pending flips
+ * are done.
+ * @param ch pointer to the channel
+ * @param display pointer to the display context
+ * @return true if the animation is in progress
+ */
+static bool animate(struct channel* ch, display* display)
+{
+    const size_t index = ch->current % DISPLAY_BUFFERS;
+    const size_t back =
+        (ch->current + DISPLAY_BUFFERS - HISTORY_FRAMES) % DISPLAY_BUFFERS;
+    const size_t next = ch->front == index ? back : index;
+    const uint64_t elapsed = now_ms() - ch->start;
+    float t;
+
+    if (!ch->start || ch->paused) {
+        return false;
+    }
+
+    t = (float)elapsed / (PHOTO_DELAY * 1000);
+    if (t >= 1.0f) {
+        t = 1.0f;
+        ch->start = 0; // last frame
+    }
+
+    draw_motion(ch, display, index, next, t);
+    for (size_t i = 0; ch->caption && i < ch->num; ++i) {
+        put_caption(ch->caption, display_draw(display, ch->first + i, next));
+    }
+    for (size_t i = 0; i < ch->num; ++i) {
+        display_commit(display, ch->first + i, next);
+    }
+    if (next == index) {
+        ch->motions[index].animated = true;
+    }
+    ch->front = next;
+
+    return ch->start;
+}
+
+/**
+ * Show slide on all outputs of the channel.
+ * @param ch pointer to the channel
+ * @param display pointer to the display context
+ * @param num slide number
+ * @return false if slide can not be shown
+ */
+static bool show_slide(struct channel* ch, display* display, size_t num)
+{
+    if (!draw_slide(ch, display, num)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < ch->num; ++i) {
+        display_commit(display, ch->first + i, num % DISPLAY_BUFFERS);
+    }
+    ch->current = num;
+    start_motion(ch);
+
+    return true;
+}
+
+/**
+ * Render next slides in advance, a small part per call.
+ * @param ch pointer to the channel
+ * @param display pointer to the display context
+ * @return true if there is more work to do
+ */
+static bool prefetch(struct channel* ch, display* display)
+{
+    if (!ch->job) {
+        // search for the first missing slide
+        for (size_t i = 1; i <= PREFETCH_FRAMES; ++i) {
+            const size_t num = ch->current + i;
+            if (ch->frames[num % DISPLAY_BUFFERS] != num) {
+                ch->job = begin_slide(ch, display, num);
+                ch->job_slide = ch->job ? num : 0;
+                return ch->job;
+            }
+        }
+        return false;
+    }
+
+    switch (render_step(ch->job, PREFETCH_ROWS)) {
+        case RENDER_PROGRESS:
+            break;
+        case RENDER_DONE:
+            finish_slide(ch, display, ch->job_slide);
+            cancel_prefetch(ch);
+            break;
+        case RENDER_ERROR:
+            drop_slide(ch, ch->job_slide, false);
+            cancel_prefetch(ch);
+            break;
+        case RENDER_CORRUPT:
+            drop_slide(ch, ch->job_slide, true);
+            cancel_prefetch(ch);
+            break;
+    }
+
+    return true;
+}
+
+/**
+ * Forget all slides after the current one.
+ * @param ch pointer to the channel
+ */
+static void forget_next(struct channel* ch)
+{
+    if (ch->job_slide > ch->current) {
+        cancel_prefetch(ch);
+    }
+    for (size_t i = 0; i < DISPLAY_BUFFERS; ++i) {
+        if (ch->frames[i] > ch->current) {
+            ch->frames[i] = 0;
+        }
+    }
+}
+
+/**
+ * Show frame passed through the control socket after the current slide.
+ * The frame is not kept in the history: it can be shown again only while
+ * its frame buffer is not reused.
+ * @param ch pointer to the channel
+ * @param display pointer to the display context
+ * @param frame frame description
+ * @param data mapped frame data
+ */
+static void show_frame(struct channel* ch, display* display,
+                       const struct frame* frame, const xrgb_t* data)
+{
+    const size_t num = ch->current + 1;
+    const size_t index = num % DISPLAY_BUFFERS;
+    struct buffer* fbs[DISPLAY_MAX_OUTPUTS];
+    render* job;
+
+    forget_next(ch);
+    ch->last = num;
+    set_slide(ch, num, NULL, false);
+    mipmap_free(ch->motions[index].mm);
+    ch->motions[index].mm = NULL;
+
+    for (size_t i = 0; i < ch->num; ++i) {
+        fbs[i] = display_draw(display, ch->first + i, index);
+    }
+    job = render_begin_pixels(data, frame->width, frame->height,
+                              frame->stride, fbs, ch->num, ch->bkg);
+    if (!job || render_step(job, 0) != RENDER_DONE) {
+        fprintf(stderr, "Unable to show frame %zux%zu\n", frame->width,
+                frame->height);
+        render_end(job);
+        ch->last = ch->current;
+        return;
+    }
+    render_end(job);
+
+    ch->frames[index] = num;
+    for (size_t i = 0; i < ch->num; ++i) {
+        display_commit(display, ch->first + i, index);
+    }
+    ch->current = num;
+    start_motion(ch);
+}
+
+/**
+ * Map frame data passed through the control socket.
+ * @param frame frame description
+ * @param size output size of the mapped data
+ * @return pointer to the frame data or NULL on errors
+ */
+static void* map_frame(const struct frame* frame, size_t* size)
+{
+    struct dma_buf_sync sync = {
+        .flags = DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ,
+    };
+    const int seals = fcntl(frame->fd, F_GET_SEALS);
+    bool dmabuf = false;
+    off_t len;
+    void* data;
+
+    if (frame->height > SIZE_MAX / frame->stride) {
+        return NULL;
+    }
+    *size = frame->stride * frame->height;
+
+    // memfd can be truncated by the client while it is mapped, which kills
+    // the player with SIGBUS, so it must be sealed against shrinking
+    if (seals < 0) {
+        // dma-buf requires CPU access bracketing, fails on other files
+        dmabuf = ioctl(frame->fd, DMA_BUF_IOCTL_SYNC, &sync) == 0;
+    }
+    if (!dmabuf && (seals < 0 || !(seals & F_SEAL_SHRINK))) {
+        fprintf(stderr, "Frame data must be dma-buf or sealed memfd\n");
+        return NULL;
+    }
+
+    len = lseek(frame->fd, 0, SEEK_END);
+    if (len < 0 || (uint64_t)len < *size) {
+        fprintf(stderr, "Frame data is too small\n");
+        data = NULL;
+    } else {
+        data = mmap(NULL, *size, PROT_READ, MAP_SHARED, frame->fd, 0);
+        if (data == MAP_FAILED) {
+            fprintf(stderr, "Unable to map frame: [%d] %s\n", errno,
+                    strerror(errno));
+            data = NULL;
+        }
+    }
+
+    if (!data && dmabuf) {
+        sync.flags = DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ;
+        ioctl(frame->fd, DMA_BUF_IOCTL_SYNC, &sync);
+    }
+
+    return data;
+}
+
+/**
+ * Unmap frame data and close its descriptor.
+ * @param frame frame description
+ * @param data mapped frame data, can be NULL
+ * @param size size of the mapped data
+ */
+static void unmap_frame(const struct frame* frame, void* data, size_t size)
+{
+    if (data) {
+        struct dma_buf_sync sync = {
+            .flags = DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ,
+        };
+        ioctl(frame->fd, DMA_BUF_IOCTL_SYNC, &sync);
+        munmap(data, size);
+    }
+    close(frame->fd);
+}
+
+/**
+ * Wait until all pending page flips are done, frame buffers queued for flip
+ * can't be redrawn until then.
+ * @param display pointer to the display context
+ */
+static void wait_flips(display* display)
+{
+    while (display_busy(display)) {
+        struct pollfd fd = {
+            .fd = display_fd(display),
+            .events = POLLIN,
+        };
+        const int rc = poll(&fd, 1, FLIP_TIMEOUT);
+        if (rc > 0) {
+            display_handle(display);
+        } else if (rc == 0 || errno != EINTR) {
+            fprintf(stderr, "Page flip timed out\n");
+            break;
+        }
+    }
+}
+
+/**
+ * Execute user command.
+ * @param ch pointer to the channel
+ * @param display pointer to the display context
+ * @param cmd command to execute
+ * @return false if no more images to show
+ */
+static bool execute(struct channel* ch, display* display,
+                    const struct command* cmd)
+{
+    switch (cmd->type) {
+        case CMD_NEXT:
+            return show_slide(ch, display, ch->current + 1);
+        case CMD_PREV:
+            if (get_slide(ch, ch->current - 1)) {
+                show_slide(ch, display, ch->current - 1);
+            }
+            break;
+        case CMD_GOTO:
+            // forget all next slides and put the new one after the current
+            forget_next(ch);
+            ch->last = ch->current + 1;
+            set_slide(ch, ch->last, cmd->path, false);
+            if (!show_slide(ch, display, ch->last)) {
+                fprintf(stderr, "Unable to show %s\n", cmd->path);
+                ch->last = ch->current;
+            }
+            break;
+        case CMD_PAUSE:
+        case CMD_FRAME:
+            break;
+    }
+    return true;
+}
+
+/**
+ * Load caption font.
+ * @param cfg slide show configuration
+ * @param display pointer to the display context
+ * @return font context or NULL if error
+ */
+static font* load_font(const struct config* cfg, display* display)
+{
+    const char* dir = getenv("XDG_CACHE_HOME");
+    size_t size = cfg->font_size;
+    char cache[PATH_MAX];
+
+    if (!size) {
+        size = display_draw(display, 0, 0)->height / CAPTION_SCALE;
+    }
+    snprintf(cache, sizeof(cache), "%s/slideshow-%zu.font",
+             dir ? dir : CACHE_DIR, size);
+
+    return font_load(cfg->font, size, cache);
 }
 
 /** POSIX signal handler. */
@@ -107,37 +890,188 @@ static void on_signal(__attribute__((unused)) int signum)
     stop_slideshow = true;
 }
 
-bool slide_show(imglist* list, display* display)
+bool slide_show(imglist* list, display* display, const struct config* cfg)
 {
-    // set signal handler
+    const size_t outputs = display_outputs(display);
+    struct channel channels[DISPLAY_MAX_OUTPUTS];
+    size_t num_channels = 0;
+    struct pollfd fds[1 + INPUT_MAX_FDS];
     struct sigaction sigact;
+    struct command cmd;
+    input* input = NULL;
+    font* fnt = NULL;
+    uint64_t deadline = 0;
+    bool paused = false;
+    bool work = true;
+    bool rc = false;
+
+    memset(channels, 0, sizeof(channels));
+
+    if (cfg->font) {
+        fnt = load_font(cfg, display);
+        if (!fnt) {
+            return false;
+        }
+    }
+
+    // mirror mode uses single channel for all outputs
+    if (cfg->independent && outputs > 1) {
+        for (size_t i = 0; i < outputs; ++i) {
+            struct channel* ch = &channels[num_channels];
+            ch->list = i == 0 ? list : imglist_dup(list);
+            if (!ch->list) {
+                goto done;
+            }
+            ch->first = i;
+            ch->num = 1;
+            ch->bkg = cfg->bkg;
+            ch->font = fnt;
+            ch->kenburns = cfg->kenburns;
+            ++num_channels;
+        }
+    } else {
+        channels[0].list = list;
+        channels[0].first = 0;
+        channels[0].num = outputs;
+        channels[0].bkg = cfg->bkg;
+        channels[0].font = fnt;
+        channels[0].kenburns = cfg->kenburns;
+        num_channels = 1;
+    }
+
+    input = input_init(cfg->control);
+    if (!input) {
+        goto done;
+    }
+
+    // set signal handler
     sigact.sa_handler = on_signal;
     sigemptyset(&sigact.sa_mask);
     sigact.sa_flags = 0;
     sigaction(SIGINT, &sigact, NULL);
     sigaction(SIGTERM, &sigact, NULL);
 
+    cmd.type = CMD_NEXT;
+
     while (!stop_slideshow) {
-        struct buffer* fb;
-        struct image* img;
+        const uint64_t now = now_ms();
+        size_t num_fds = 0;
+        int timeout = -1;
 
-        img = next_image(list);
-        if (!img) {
-            break;
+        // switch slides by timer
+        if (!paused && now >= deadline) {
+            wait_flips(display);
+            for (size_t i = 0; i < num_channels; ++i) {
+                if (!execute(&channels[i], display, &cmd)) {
+                    goto no_images;
+                }
+            }
+            deadline = now_ms() + PHOTO_DELAY * 1000;
+            work = true;
+            continue;
+        }
+
+        // don't touch buffers until all pending flips are done
+        if (work && !display_busy(display)) {
+            work = false;
+            for (size_t i = 0; i < num_channels; ++i) {
+                work |= animate(&channels[i], display);
+                work |= prefetch(&channels[i], display);
+            }
         }
 
-        fb = display_draw(display);
-        if (img->width == fb->width && img->height == fb->height) {
-            copy_image(img, fb);
-        } else {
-            scale_image(img, fb);
+        if (work && !display_busy(display)) {
+            timeout = 0;
+        } else if (!paused) {
+            timeout = deadline - now;
         }
-        display_commit(display);
 
-        free(img);
+        fds[num_fds].fd = display_fd(display);
+        fds[num_fds].events = POLLIN;
+        fds[num_fds].revents = 0;
+        ++num_fds;
+        num_fds += input_poll(input, &fds[num_fds]);
+
+        if (poll(fds, num_fds, timeout) < 0 && errno != EINTR) {
+            fprintf(stderr, "Poll error: [%d] %s\n", errno, strerror(errno));
+            goto done;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            display_handle(display);
+            work = true;
+        }
 
-        sleep(PHOTO_DELAY);
+        for (size_t i = 1; i < num_fds; ++i) {
+            struct command input_cmd;
+            if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                // otherwise poll returns immediately forever
+                input_close(input, fds[i].fd);
+                continue;
+            }
+            if (!(fds[i].revents & POLLIN)) {
+                continue;
+            }
+            while (input_read(input, fds[i].fd, &input_cmd)) {
+                size_t delay = PHOTO_DELAY;
+                if (input_cmd.type != CMD_PAUSE) {
+                    // commands in a burst must not redraw queued buffers
+                    wait_flips(display);
+                }
+                if (input_cmd.type == CMD_PAUSE) {
+                    paused = !paused;
+                    for (size_t j = 0; j < num_channels; ++j) {
+                        pause_motion(&channels[j], paused);
+                    }
+                } else if (input_cmd.type == CMD_FRAME) {
+                    const struct frame* frame = &input_cmd.frame;
+                    size_t size = 0;
+                    void* data = map_frame(frame, &size);
+                    if (data) {
+                        for (size_t j = 0; j < num_channels; ++j) {
+                            show_frame(&channels[j], display, frame, data);
+                        }
+                        if (frame->duration) {
+                            delay = frame->duration;
+                        }
+                    }
+                    unmap_frame(frame, data, size);
+                } else {
+                    for (size_t j = 0; j < num_channels; ++j) {
+                        if (!execute(&channels[j], display, &input_cmd)) {
+                            goto no_images;
+                        }
+                    }
+                }
+                deadline = now_ms() + delay * 1000;
+                work = true;
+            }
+        }
     }
 
-    return stop_slideshow;
+    rc = true;
+    goto done;
+
+no_images:
+    fprintf(stderr, "No more images in the list\n");
+
+done:
+    input_free(input);
+    for (size_t i = 0; i < num_channels; ++i) {
+        struct channel* ch = &channels[i];
+        cancel_prefetch(ch);
+        for (size_t j = 0; j < HISTORY_PATHS; ++j) {
+            free(ch->slides[j].path);
+        }
+        for (size_t j = 0; j < DISPLAY_BUFFERS; ++j) {
+            mipmap_free(ch->motions[j].mm);
+        }
+        font_text_free(ch->caption);
+        // the first list is owned by the caller
+        if (i != 0) {
+            imglist_free(ch->list);
+        }
+    }
+    font_free(fnt);
+    return rc;
 }
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "config.h"
 #include "display.h"
 #include "imglist.h"
 
@@ -13,6 +14,7 @@
  * Start slide show.
  * @param list pointer to the image list context
  * @param display pointer to the display context
+ * @param cfg slide show configuration
  * @return true if slide show exit by normally by signal or false on errors
  */
-bool slide_show(imglist* list, display* display);
+bool slide_show(imglist* list, display* display, const struct config* cfg);
@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: MIT
+// WebP decoder.
+// Copyright (C) 2025 Artem Senichev <artemsen@gmail.com>
+
+#include "codec.h"
+
+#include <string.h>
+
+#include <webp/decode.h>
+
+/** Size of the chunk read from the file at once. */
+#define READ_CHUNK (64 * 1024)
+
+/** WebP decoder context, the output buffer holds the whole image. */
+struct webp_decoder {
+    WebPDecoderConfig config;   ///< Decoder configuration and output buffer
+    WebPIDecoder* idec;         ///< Incremental decoder
+    FILE* file;                 ///< Source file
+    uint8_t buffer[READ_CHUNK]; ///< Data read from the file
+    size_t size;                ///< Size of the data in the buffer
+};
+
+/**
+ * Check status of the decoder, invalid data marks the image as corrupt.
+ * @param img image instance
+ * @param status decoder status
+ * @return true if decoding can be continued
+ */
+static bool check_status(struct image* img, VP8StatusCode status)
+{
+    if (status == VP8_STATUS_OK || status == VP8_STATUS_SUSPENDED) {
+        return true;
+    }
+    img->corrupt = status == VP8_STATUS_BITSTREAM_ERROR ||
+        status == VP8_STATUS_UNSUPPORTED_FEATURE ||
+        status == VP8_STATUS_NOT_ENOUGH_DATA;
+    return false;
+}
+
+/**
+ * Check WebP signature.
+ * @param sig file signature
+ * @param size size of the signature
+ * @return true if file is WebP
+ */
+static bool webp_dec_match(const uint8_t* sig, size_t size)
+{
+    return size >= 12 && memcmp(sig, "RIFF", 4) == 0 &&
+        memcmp(sig + 8, "WEBP", 4) == 0;
+}
+
+/**
+ * Read WebP header.
+ * @param img image instance
+ * @param file source file
+ * @return true if header was read successfully
+ */
+static bool webp_dec_open(struct image* img, FILE* file)
+{
+    struct webp_decoder* dec = img->decoder;
+    WebPBitstreamFeatures* features = &dec->config.input;
+
+    dec->file = file;
+    if (!WebPInitDecoderConfig(&dec->config)) {
+        return false;
+    }
+
+    // the first chunk is passed to the decoder later
+    dec->size = fread(dec->buffer, 1, sizeof(dec->buffer), file);
+    if (ferror(file) ||
+        !check_status(img, WebPGetFeatures(dec->buffer, dec->size, features)) ||
+        features->has_animation) {
+        return false;
+    }
+
+    img->width = features->width;
+    img->height = features->height;
+
+    return true;
+}
+
+/**
+ * Start decoding WebP image.
+ * @param img image instance
+ * @param width,height output size hint
+ * @return true if decoding started successfully
+ */
+static bool webp_dec_start(struct image* img, size_t width, size_t height)
+{
+    struct webp_decoder* dec = img->decoder;
+    WebPDecoderOptions* options = &dec->config.options;
+    unsigned int denom = 8;
+
+    // downscale by the same factors as JPEG does
+    if (width && height) {
+        while (denom > 1 && img->width < denom * width &&
+               img->height < denom * height) {
+            denom /= 2;
+        }
+        if (denom > 1) {
+            options->use_scaling = 1;
+            options->scaled_width = (img->width + denom - 1) / denom;
+            options->scaled_height = (img->height + denom - 1) / denom;
+            img->width = options->scaled_width;
+            img->height = options->scaled_height;
+        }
+    }
+
+    // decoder allocates the whole output image
+    if (img->height > CODEC_MAX_BUFFER / (img->width * sizeof(xrgb_t))) {
+        return false;
+    }
+
+    // premultiplied alpha puts transparent pixels on black background
+    dec->config.output.colorspace = MODE_bgrA;
+    dec->idec = WebPIDecode(NULL, 0, &dec->config);
+    if (!dec->idec) {
+        return false;
+    }
+
+    return check_status(img, WebPIAppend(dec->idec, dec->buffer, dec->size));
+}
+
+/**
+ * Get next row of WebP image, the file is read and decoded by chunks until
+ * the row is available.
+ * @param img image instance
+ * @param row destination buffer
+ * @return true if row was decoded successfully
+ */
+static bool webp_dec_read(struct image* img, xrgb_t* row)
+{
+    struct webp_decoder* dec = img->decoder;
+    const uint8_t* data;
+    int last = 0, width, height, stride;
+
+    data = WebPIDecGetRGB(dec->idec, &last, &width, &height, &stride);
+    while (!data || (size_t)last <= img->row) {
+        dec->size = fread(dec->buffer, 1, sizeof(dec->buffer), dec->file);
+        if (!dec->size) {
+            img->corrupt = !ferror(dec->file); // truncated file
+            return false;
+        }
+        if (!check_status(img,
+                          WebPIAppend(dec->idec, dec->buffer, dec->size))) {
+            return false;
+        }
+        data = WebPIDecGetRGB(dec->idec, &last, &width, &height, &stride);
+    }
+
+    memcpy(row, data + img->row * stride, img->width * sizeof(xrgb_t));
+
+    return true;
+}
+
+/**
+ * Free WebP decoder.
+ * @param img image instance
+ */
+static void webp_dec_close(struct image* img)
+{
+    struct webp_decoder* dec = img->decoder;
+
+    if (dec->idec) {
+        WebPIDelete(dec->idec);
+    }
+    WebPFreeDecBuffer(&dec->config.output);
+    if (dec->file) {
+        fclose(dec->file);
+    }
+}
+
+const struct codec codec_webp = {
+    .context = sizeof(struct webp_decoder),
+    .match = webp_dec_match,
+    .open = webp_dec_open,
+    .start = webp_dec_start,
+    .read = webp_dec_read,
+    .close = webp_dec_close,
+};